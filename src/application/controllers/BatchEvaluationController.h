@@ -0,0 +1,93 @@
+#ifndef BATCHEVALUATIONCONTROLLER_H
+#define BATCHEVALUATIONCONTROLLER_H
+
+#include <filesystem>
+#include <functional>
+#include "../../domain/entities/EvaluationResult.h"
+#include "../../domain/services/CorpusArchive.h"
+#include "../services/BatchEvaluationService.h"
+#include "CFGBuilderController.h"
+
+
+/**
+ * @class BatchEvaluationController
+ * @brief This class calls services to measure detection accuracy over a dataset.
+ */
+class BatchEvaluationController {
+    private:
+        CFGBuilderController cfgBuilderController;
+        size_t threads;
+
+    public:
+        BatchEvaluationController(size_t);
+        ~BatchEvaluationController();
+        void useCache(const std::filesystem::path&);
+        void useBudget(const ExtractionBudget&);
+        EvaluationSummary evaluate(const std::filesystem::path&, double, const std::function<void(const CaseResult&)>&);
+        EvaluationSummary evaluate(const CorpusArchive&, double, const std::function<void(const CaseResult&)>&);
+};
+
+
+/**
+ * @brief Constructor for the BatchEvaluationController class.
+ * @param threads Parser threads (and resident extractor workers)
+ */
+BatchEvaluationController::BatchEvaluationController(size_t threads) : cfgBuilderController(threads), threads(threads) {}
+
+
+/**
+ * @brief Destructor for the BatchEvaluationController class.
+ */
+BatchEvaluationController::~BatchEvaluationController(){}
+
+
+/**
+ * @brief Keep built graphs in an on-disk cache keyed by source content.
+ * @param directory Cache directory
+ */
+void BatchEvaluationController::useCache(const std::filesystem::path& directory) {
+    cfgBuilderController.useCache(directory);
+}
+
+
+/**
+ * @brief Kill and skip the extraction of any file that goes over a budget.
+ * @param budget Per-file limits
+ */
+void BatchEvaluationController::useBudget(const ExtractionBudget& budget) {
+    cfgBuilderController.useBudget(budget);
+}
+
+
+/**
+ * @brief Call BatchEvaluationService to score every case of a dataset.
+ * @param dataset Directory holding one sub-directory per case
+ * @param threshold Similarity from which a pair counts as plagiarism
+ * @param onCase Called as each case completes
+ * @return Totals over every case
+ */
+EvaluationSummary BatchEvaluationController::evaluate(const std::filesystem::path& dataset, double threshold, const std::function<void(const CaseResult&)>& onCase) {
+    BatchEvaluationService evaluation;
+    return evaluation.evaluate(dataset, threshold, [this](std::filesystem::path& file, GraphArena* arena) {
+        return cfgBuilderController.getGraph(file, arena);
+    }, onCase, threads);
+}
+
+
+/**
+ * @brief Call BatchEvaluationService to score every case of a packed dataset. Its archived
+ *        CFGs are used when the current extractor built them, sources are extracted otherwise.
+ * @param archive Dataset packed with CorpusArchive::pack
+ * @param threshold Similarity from which a pair counts as plagiarism
+ * @param onCase Called as each case completes
+ * @return Totals over every case
+ */
+EvaluationSummary BatchEvaluationController::evaluate(const CorpusArchive& archive, double threshold, const std::function<void(const CaseResult&)>& onCase) {
+    bool archivedCFGs = !archive.getSalt().empty() && archive.getSalt() == CFGBuilderService::cacheSalt();
+    BatchEvaluationService evaluation;
+    return evaluation.evaluate(archive, threshold, [this, &archive, archivedCFGs](std::filesystem::path& file, GraphArena* arena) {
+        return cfgBuilderController.getGraph(archive, file, archivedCFGs, arena);
+    }, onCase, threads);
+}
+
+#endif // BATCHEVALUATIONCONTROLLER_H
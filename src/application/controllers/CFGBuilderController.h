@@ -2,8 +2,13 @@
 #define CFGBUILDERCONTROLLER_H
 
 #include<string>
+#include <memory>
 #include "../../domain/entities/UGraph.h"
 #include "../services/CFGBuilderService.h"
+#include "../../domain/services/CFGCache.h"
+#include "../../domain/services/CorpusArchive.h"
+#include "../../domain/services/GraphSerializer.h"
+#include "../../domain/services/Metrics.h"
 
 
 /**
@@ -11,10 +16,22 @@
  * @brief This class calls service to build a CFG from an AST.
  */
 class CFGBuilderController {
+    private:
+        std::shared_ptr<CFGWorkerPool> workers;
+        std::shared_ptr<CFGCache> cache;
+        ExtractionBudget budget;
+
+        UGraph<std::string>* build(std::filesystem::path&, GraphArena*);
+
     public:
         CFGBuilderController();
+        CFGBuilderController(size_t);
         ~CFGBuilderController();
-        UGraph<std::string>* getGraph(std::filesystem::path&); 
+        void useCache(const std::filesystem::path&);
+        void useBudget(const ExtractionBudget&);
+        UGraph<std::string>* getGraph(std::filesystem::path&, GraphArena* = nullptr);
+        UGraph<std::string>* getGraph(const CorpusArchive&, const std::filesystem::path&, bool, GraphArena* = nullptr);
+        std::vector<CFGStreamParser::Method> getMethods(std::filesystem::path&, const std::vector<std::string>&);
 };
 
 
@@ -24,6 +41,18 @@ class CFGBuilderController {
 CFGBuilderController::CFGBuilderController(){}
 
 
+/**
+ * @brief Constructor that keeps resident extractor workers for every getGraph call.
+ *        Ignored when the CFGs are built in-process (-DNATIVE_CFG).
+ * @param workers Number of tools/AST.py workers to start
+ */
+CFGBuilderController::CFGBuilderController(size_t workers) {
+#ifndef NATIVE_CFG
+    this->workers = CFGBuilderService::startWorkers(workers);
+#endif
+}
+
+
 /**
  * @brief Destructor for the CFGBuilderController class.
  */
@@ -31,13 +60,137 @@ CFGBuilderController::~CFGBuilderController(){}
 
 
 /**
- * @brief Call CFGBuilderService to generate Control Flow Graph.
+ * @brief Keep built graphs in an on-disk cache keyed by source content.
+ * @param directory Cache directory
+ */
+void CFGBuilderController::useCache(const std::filesystem::path& directory) {
+    cache = std::make_shared<CFGCache>(directory, CFGBuilderService::cacheSalt());
+}
+
+
+/**
+ * @brief Kill and skip the extraction of any file that goes over a budget. Skipped files
+ *        count as errors, and as budget_wall, budget_cpu or budget_rss in the metrics.
+ * @param limits Per-file limits
+ */
+void CFGBuilderController::useBudget(const ExtractionBudget& limits) {
+    budget = limits;
+    if (workers) {
+        workers->setBudget(limits);
+    }
+}
+
+
+/**
+ * @brief Call CFGBuilderService to generate Control Flow Graph, through the cache if enabled.
  * @param ast ast to process
+ * @param arena Arena that owns the graph, nullptr for a graph owned (and deleted) by the caller
+ * @return UGraph representing the CFG
+ */
+UGraph<std::string>* CFGBuilderController::getGraph(std::filesystem::path& sourceCode, GraphArena* arena) {
+    Metrics::add(Metrics::FILES);
+    if (!cache) {
+        return build(sourceCode, arena);
+    }
+
+    std::string key;
+    UGraph<std::string>* graph;
+    try {
+        Metrics::Timer timer(Metrics::CACHE_LOOKUP);
+        key = cache->key(sourceCode);
+        graph = cache->get(key, arena);
+    } catch (const std::exception& e) {
+        return build(sourceCode, arena);
+    }
+
+    if (graph) {
+        Metrics::add(Metrics::CACHE_HITS);
+        return graph;
+    }
+    Metrics::add(Metrics::CACHE_MISSES);
+
+    graph = build(sourceCode, arena);
+    if (graph) {
+        Metrics::Timer timer(Metrics::CACHE_STORE);
+        cache->put(key, *graph);
+    }
+    return graph;
+}
+
+
+/**
+ * @brief CFG of an archived file: its archived CFG when there is one, otherwise built from
+ *        the archived source. Neither is copied out of the archive's mapping first.
+ * @param archive Packed corpus
+ * @param file Path of the file inside the archive
+ * @param archivedCFGs Whether the archive's CFGs were built by this extractor
+ *                     (CorpusArchive::getSalt() == CFGBuilderService::cacheSalt())
+ * @param arena Arena that owns the graph, nullptr for a graph owned (and deleted) by the caller
+ * @return UGraph representing the CFG, nullptr if the file is not archived or cannot be built
+ */
+UGraph<std::string>* CFGBuilderController::getGraph(const CorpusArchive& archive, const std::filesystem::path& file, bool archivedCFGs, GraphArena* arena) {
+    Metrics::add(Metrics::FILES);
+    size_t index = archive.find(file.generic_string());
+    if (index == (size_t) -1) {
+        Metrics::add(Metrics::ERRORS);
+        return nullptr;
+    }
+    CorpusArchive::File entry = archive.get(index);
+
+    if (archivedCFGs && !entry.cfg.empty()) {
+        try {
+            Metrics::Timer timer(Metrics::CACHE_LOOKUP);
+            UGraph<std::string>* graph = GraphSerializer::deserialize(entry.cfg.data(), entry.cfg.size(), arena);
+            Metrics::add(Metrics::CACHE_HITS);
+            return graph;
+        } catch (const std::exception& e) {
+            // Build it from the source instead
+        }
+    }
+
+    CFGBuilderService builder(budget);
+    UGraph<std::string>* graph = workers? builder.buildSource(entry.source, *workers, arena) : builder.buildSource(entry.source, arena);
+    if (!graph) {
+        Metrics::add(Metrics::ERRORS);
+    }
+    return graph;
+}
+
+
+/**
+ * @brief Call CFGBuilderService to extract the sub-CFG of every method of a file.
+ *        Resident workers skip the methods the caller already has; other extractors
+ *        build every method.
+ * @param sourceCode File to analyze
+ * @param known Hashes of the methods the caller already has
+ * @throws std::runtime_error if the extraction fails.
+ * @return Methods of the file
+ */
+std::vector<CFGStreamParser::Method> CFGBuilderController::getMethods(std::filesystem::path& sourceCode, const std::vector<std::string>& known) {
+    Metrics::add(Metrics::FILES);
+    try {
+        CFGBuilderService builder(budget);
+        return workers ? builder.buildMethods(sourceCode, *workers, known) : builder.buildMethods(sourceCode);
+    } catch (const std::exception& e) {
+        Metrics::add(Metrics::ERRORS);
+        throw;
+    }
+}
+
+
+/**
+ * @brief Build a graph with the resident workers if any, otherwise with a new extractor.
+ * @param sourceCode File to analyze
+ * @param arena Arena that owns the graph, nullptr for a graph owned by the caller
  * @return UGraph representing the CFG
  */
-UGraph<std::string>* CFGBuilderController::getGraph(std::filesystem::path& sourceCode) {
-    CFGBuilderService builder;
-    return builder.build(sourceCode);
+UGraph<std::string>* CFGBuilderController::build(std::filesystem::path& sourceCode, GraphArena* arena) {
+    CFGBuilderService builder(budget);
+    UGraph<std::string>* graph = workers? builder.build(sourceCode, *workers, arena) : builder.build(sourceCode, arena);
+    if (!graph) {
+        Metrics::add(Metrics::ERRORS);
+    }
+    return graph;
 }
 
 #endif // CFGBUILDERCONTROLLER_H
\ No newline at end of file
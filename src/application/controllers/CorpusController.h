@@ -0,0 +1,172 @@
+#ifndef CORPUSCONTROLLER_H
+#define CORPUSCONTROLLER_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../../domain/entities/SimilarityPair.h"
+#include "../services/CorpusService.h"
+#include "../services/CFGBuilderService.h"
+#include "../services/SimilarityService.h"
+#include "../../domain/services/LabelNormalizer.h"
+#include "../../domain/services/ScoreStore.h"
+#include "CFGBuilderController.h"
+
+
+/**
+ * @class CorpusController
+ * @brief This class calls services to find suspicious pairs in a whole corpus.
+ */
+class CorpusController {
+    private:
+        CFGBuilderController cfgBuilderController;
+        double minOverlap;
+        std::shared_ptr<ScoreStore> scoreStore;
+
+    public:
+        CorpusController();
+        CorpusController(size_t);
+        ~CorpusController();
+        void useCache(const std::filesystem::path&);
+        void useBudget(const ExtractionBudget&);
+        void useFingerprintFilter(double);
+        void useScoreStore(const std::filesystem::path&);
+        std::vector<ScoreStore::Score> getStoredScores(const std::filesystem::path&) const;
+        std::vector<SimilarityPair> getSuspiciousPairs(std::vector<std::filesystem::path>&, double);
+        std::vector<SimilarityPair> getSuspiciousPairs(std::vector<std::filesystem::path>&, double, size_t, size_t);
+        std::vector<SimilarityPair> getArchivedPairs(std::vector<std::filesystem::path>&, std::vector<std::filesystem::path>&, double, size_t, size_t);
+};
+
+
+/**
+ * @brief Constructor for the CorpusController class (one extractor process per file).
+ */
+CorpusController::CorpusController() : minOverlap(0.0) {}
+
+
+/**
+ * @brief Constructor that keeps resident extractor workers while the corpus is parsed.
+ * @param workers Number of tools/AST.py workers
+ */
+CorpusController::CorpusController(size_t workers) : cfgBuilderController(workers), minOverlap(0.0) {}
+
+
+/**
+ * @brief Destructor for the CorpusController class.
+ */
+CorpusController::~CorpusController(){}
+
+
+/**
+ * @brief Keep built graphs in an on-disk cache keyed by source content.
+ * @param directory Cache directory
+ */
+void CorpusController::useCache(const std::filesystem::path& directory) {
+    cfgBuilderController.useCache(directory);
+}
+
+
+/**
+ * @brief Kill and skip the extraction of any file that goes over a budget.
+ * @param budget Per-file limits
+ */
+void CorpusController::useBudget(const ExtractionBudget& budget) {
+    cfgBuilderController.useBudget(budget);
+}
+
+
+/**
+ * @brief Skip pairs whose Weisfeiler-Lehman histograms overlap less than a minimum before scoring them.
+ * @param overlap Minimum overlap in [0, 1], 0 to score every pair (the default)
+ */
+void CorpusController::useFingerprintFilter(double overlap) {
+    minOverlap = overlap;
+}
+
+
+/**
+ * @brief Keep pair scores in an on-disk store across runs, so a rerun only scores new pairs.
+ *        The store is compacted when most of its records are dead.
+ * @param file Store file, created if missing
+ * @throws std::runtime_error if the file is not a score store or cannot be written.
+ */
+void CorpusController::useScoreStore(const std::filesystem::path& file) {
+    scoreStore = std::make_shared<ScoreStore>(file, CFGBuilderService::cacheSalt() + ":" + LabelNormalizer::version() + ":" + SimilarityService::SCORING_VERSION);
+    if (scoreStore->deadRecords() > scoreStore->size()) {
+        scoreStore->compact();
+    }
+}
+
+
+/**
+ * @brief Every stored score involving a file, without scoring anything.
+ * @param file Source file
+ * @throws std::runtime_error if the file cannot be read.
+ * @return Scores with the file's content key as first, empty without a store
+ */
+std::vector<ScoreStore::Score> CorpusController::getStoredScores(const std::filesystem::path& file) const {
+    if (!scoreStore) return {};
+    return scoreStore->scoresOf(ScoreStore::contentKey(CFGCache::readFile(file)));
+}
+
+
+/**
+ * @brief Build every CFG once and rank all pairs of files by similarity.
+ *        Files with equal fingerprints are scored once.
+ * @param files Corpus files
+ * @param threshold Minimum similarity to report
+ * @return Pairs (indexes into files) scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusController::getSuspiciousPairs(std::vector<std::filesystem::path>& files, double threshold) {
+    CorpusService corpus;
+    corpus.useStore(scoreStore.get());
+    std::vector<GraphFingerprint> fingerprints;
+    std::vector<TransitionVector> matrices = corpus.prepare(files, [this](std::filesystem::path& file, GraphArena* arena) {
+        return cfgBuilderController.getGraph(file, arena);
+    }, fingerprints);
+    return corpus.compareUnique(matrices, fingerprints, threshold, minOverlap);
+}
+
+
+/**
+ * @brief Build every CFG once and score only the pairs retrieved by MinHash/LSH.
+ * @param files Corpus files
+ * @param threshold Minimum similarity to report
+ * @param bands LSH bands (more bands, more recall)
+ * @param rows MinHash values per band (more rows, fewer candidates)
+ * @return Candidate pairs (indexes into files) scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusController::getSuspiciousPairs(std::vector<std::filesystem::path>& files, double threshold, size_t bands, size_t rows) {
+    CorpusService corpus;
+    MinHashIndex minHash(bands, rows);
+    std::vector<TransitionVector> matrices = corpus.prepare(files, [this](std::filesystem::path& file, GraphArena* arena) {
+        return cfgBuilderController.getGraph(file, arena);
+    });
+    return corpus.compareCandidates(matrices, threshold, minHash);
+}
+
+
+/**
+ * @brief Check new files against an archive (e.g. prior years' submissions), scoring each
+ *        new file only against the archived files it shares an LSH bucket with.
+ * @param files New files
+ * @param archive Archived files
+ * @param threshold Minimum similarity to report
+ * @param bands LSH bands (more bands, more recall)
+ * @param rows MinHash values per band (more rows, fewer candidates)
+ * @return Pairs (index into files, index into archive) scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusController::getArchivedPairs(std::vector<std::filesystem::path>& files, std::vector<std::filesystem::path>& archive, double threshold, size_t bands, size_t rows) {
+    CorpusService corpus;
+    MinHashIndex archiveIndex(bands, rows);
+    auto getGraph = [this](std::filesystem::path& file, GraphArena* arena) {
+        return cfgBuilderController.getGraph(file, arena);
+    };
+    std::vector<TransitionVector> archived = corpus.prepare(archive, getGraph);
+    corpus.index(archived, archiveIndex);
+    std::vector<TransitionVector> queries = corpus.prepare(files, getGraph);
+    return corpus.compareAgainst(queries, archived, archiveIndex, threshold);
+}
+
+#endif // CORPUSCONTROLLER_H
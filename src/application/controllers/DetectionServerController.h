@@ -0,0 +1,217 @@
+#ifndef DETECTIONSERVERCONTROLLER_H
+#define DETECTIONSERVERCONTROLLER_H
+
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "../../domain/services/Metrics.h"
+#include "../../domain/services/SocketServer.h"
+#include "../services/DetectionService.h"
+#include "../services/IncrementalAnalysisService.h"
+#include "../services/SimilarityService.h"
+#include "CFGBuilderController.h"
+
+
+/**
+ * @class DetectionServerController
+ * @brief Resident detector: keeps the extractor workers, the CFG cache and every assignment's
+ *        reference matrices warm, and answers requests over a Unix domain socket.
+ *        Submissions are analyzed per method, so scoring a resubmitted file only extracts
+ *        the methods that changed since the last SCORE of the same path.
+ *
+ *        Requests (one line each):
+ *          SCORE <assignment> <file>     -> OK <references> <milliseconds>, then "<score> <reference>" lines
+ *          LOAD <assignment> <directory> -> OK <references> <milliseconds>
+ *          LIST                          -> OK <assignments>, then "<assignment> <references>" lines
+ *          STATS                         -> OK, then the Metrics JSON report
+ *        Failures answer "ERROR <reason>".
+ */
+class DetectionServerController {
+    private:
+        CFGBuilderController cfgBuilderController;
+        DetectionService detection;
+        IncrementalAnalysisService incremental;
+        std::mutex serverLock;
+        std::unique_ptr<SocketServer> server;
+        bool stopped = false;
+
+        std::string score(const std::string&, std::filesystem::path);
+        std::string load(const std::string&, const std::filesystem::path&);
+
+    public:
+        DetectionServerController(size_t);
+        ~DetectionServerController();
+        void useCache(const std::filesystem::path&);
+        void useBudget(const ExtractionBudget&);
+        size_t loadReferences(const std::filesystem::path&);
+        std::string handle(const std::string&);
+        void serve(const std::filesystem::path&, size_t);
+        void stop();
+};
+
+
+/**
+ * @brief Constructor for the DetectionServerController class.
+ * @param workers Number of resident tools/AST.py workers
+ */
+DetectionServerController::DetectionServerController(size_t workers) : cfgBuilderController(workers) {}
+
+
+/**
+ * @brief Destructor for the DetectionServerController class.
+ */
+DetectionServerController::~DetectionServerController(){}
+
+
+/**
+ * @brief Keep built graphs in an on-disk cache keyed by source content.
+ * @param directory Cache directory
+ */
+void DetectionServerController::useCache(const std::filesystem::path& directory) {
+    cfgBuilderController.useCache(directory);
+}
+
+
+/**
+ * @brief Kill and skip the extraction of any file that goes over a budget.
+ * @param budget Per-file limits
+ */
+void DetectionServerController::useBudget(const ExtractionBudget& budget) {
+    cfgBuilderController.useBudget(budget);
+}
+
+
+/**
+ * @brief Load every sub-directory of a directory as an assignment named after it.
+ * @param directory Directory with one sub-directory of reference files per assignment
+ * @return Number of assignments loaded
+ */
+size_t DetectionServerController::loadReferences(const std::filesystem::path& directory) {
+    size_t loaded = 0;
+    for (const auto & assignment : std::filesystem::directory_iterator(directory)) {
+        if (!assignment.is_directory()) continue;
+        try {
+            std::string name = assignment.path().filename().string();
+            std::cout << name << ": " << load(name, assignment.path());
+            loaded++;
+        } catch (const std::exception& e) {
+            std::cerr << "Error while loading " << assignment.path() << ": " << e.what() << std::endl;
+        }
+    }
+    return loaded;
+}
+
+
+/**
+ * @brief (Re)load the references of an assignment.
+ */
+std::string DetectionServerController::load(const std::string& assignment, const std::filesystem::path& directory) {
+    uint64_t start = Metrics::now();
+    size_t references = detection.load(assignment, directory, [this](std::filesystem::path& file, GraphArena* arena) {
+        return cfgBuilderController.getGraph(file, arena);
+    });
+
+    std::ostringstream response;
+    response << "OK " << references << " " << std::fixed << std::setprecision(3) << (Metrics::now() - start) / 1e6 << "\n";
+    return response.str();
+}
+
+
+/**
+ * @brief Score a submitted file against the references of an assignment.
+ */
+std::string DetectionServerController::score(const std::string& assignment, std::filesystem::path file) {
+    uint64_t start = Metrics::now();
+    // An unknown assignment must not cost an extraction nor enter the incremental cache
+    detection.checkLoaded(assignment);
+    TransitionVector submission = incremental.getTransitions(file, [this](std::filesystem::path& source, const std::vector<std::string>& known) {
+        return cfgBuilderController.getMethods(source, known);
+    });
+    std::vector<std::pair<std::filesystem::path, double>> scores = detection.score(assignment, submission);
+
+    std::ostringstream response;
+    response << "OK " << scores.size() << " " << std::fixed << std::setprecision(3) << (Metrics::now() - start) / 1e6 << "\n";
+    response << std::setprecision(6);
+    for (const auto& reference : scores) {
+        response << reference.second << " " << reference.first.string() << "\n";
+    }
+    return response.str();
+}
+
+
+/**
+ * @brief Answer one request.
+ * @param request Request line
+ * @return Response text
+ */
+std::string DetectionServerController::handle(const std::string& request) {
+    Metrics::Timer timer(Metrics::REQUEST);
+    std::istringstream input(request);
+    std::string command, assignment, argument;
+    input >> command >> assignment;
+    std::getline(input >> std::ws, argument);
+
+    try {
+        if (command == "SCORE" && !assignment.empty() && !argument.empty()) {
+            return score(assignment, argument);
+        }
+        if (command == "LOAD" && !assignment.empty() && !argument.empty()) {
+            return load(assignment, argument);
+        }
+        if (command == "LIST") {
+            std::vector<std::pair<std::string, size_t>> assignments = detection.getAssignments();
+            std::ostringstream response;
+            response << "OK " << assignments.size() << "\n";
+            for (const auto& loaded : assignments) {
+                response << loaded.first << " " << loaded.second << "\n";
+            }
+            return response.str();
+        }
+        if (command == "STATS") {
+            return "OK\n" + Metrics::toJson();
+        }
+    } catch (const std::exception& e) {
+        Metrics::add(Metrics::ERRORS);
+        return std::string("ERROR ") + e.what() + "\n";
+    }
+    return "ERROR usage: SCORE <assignment> <file> | LOAD <assignment> <directory> | LIST | STATS\n";
+}
+
+
+/**
+ * @brief Serve requests on a Unix domain socket until stop() is called.
+ * @param socketPath Socket file
+ * @param threads Requests answered at once
+ * @throws std::runtime_error if the socket cannot be bound.
+ */
+void DetectionServerController::serve(const std::filesystem::path& socketPath, size_t threads) {
+    {
+        std::lock_guard<std::mutex> guard(serverLock);
+        if (stopped) return;
+        server = std::make_unique<SocketServer>(socketPath, threads, [this](const std::string& request) {
+            return handle(request);
+        });
+    }
+    server->run();
+
+    std::lock_guard<std::mutex> guard(serverLock);
+    server.reset();
+}
+
+
+/**
+ * @brief Make serve() return. Safe to call from another thread.
+ */
+void DetectionServerController::stop() {
+    std::lock_guard<std::mutex> guard(serverLock);
+    stopped = true;
+    if (server) {
+        server->stop();
+    }
+}
+
+#endif // DETECTIONSERVERCONTROLLER_H
@@ -0,0 +1,66 @@
+#ifndef METHODINDEXCONTROLLER_H
+#define METHODINDEXCONTROLLER_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "../../domain/entities/MethodMatch.h"
+#include "../services/MethodIndexService.h"
+#include "CFGBuilderController.h"
+
+
+/**
+ * @class MethodIndexController
+ * @brief This class calls services to find the corpus methods a file may have copied.
+ */
+class MethodIndexController {
+    private:
+        CFGBuilderController cfgBuilderController;
+        MethodIndexService methodIndex;
+
+    public:
+        MethodIndexController(size_t);
+        ~MethodIndexController();
+        size_t index(std::vector<std::filesystem::path>&);
+        std::vector<MethodMatch> getMatches(std::filesystem::path&, double);
+};
+
+
+/**
+ * @brief Constructor that keeps resident extractor workers while the corpus is indexed.
+ * @param workers Number of tools/AST.py workers
+ */
+MethodIndexController::MethodIndexController(size_t workers) : cfgBuilderController(workers) {}
+
+
+/**
+ * @brief Destructor for the MethodIndexController class.
+ */
+MethodIndexController::~MethodIndexController(){}
+
+
+/**
+ * @brief Index every method of the corpus files.
+ * @param files Corpus files
+ * @return Number of methods indexed
+ */
+size_t MethodIndexController::index(std::vector<std::filesystem::path>& files) {
+    return methodIndex.add(files, [this](std::filesystem::path& file, const std::vector<std::string>& known) {
+        return cfgBuilderController.getMethods(file, known);
+    });
+}
+
+
+/**
+ * @brief Look up every method of a file in the index.
+ * @param file Query file
+ * @param threshold Minimum similarity to report
+ * @return Matching (query method, corpus file, corpus method) triples, most similar first
+ */
+std::vector<MethodMatch> MethodIndexController::getMatches(std::filesystem::path& file, double threshold) {
+    return methodIndex.query(file, [this](std::filesystem::path& source, const std::vector<std::string>& known) {
+        return cfgBuilderController.getMethods(source, known);
+    }, threshold);
+}
+
+#endif // METHODINDEXCONTROLLER_H
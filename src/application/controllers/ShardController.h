@@ -0,0 +1,82 @@
+#ifndef SHARDCONTROLLER_H
+#define SHARDCONTROLLER_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../../domain/entities/SimilarityPair.h"
+#include "../../domain/entities/ShardReport.h"
+#include "../../domain/entities/ExtractionBudget.h"
+#include "../../domain/services/CFGWorkerPool.h"
+#include "../services/ShardService.h"
+
+
+/**
+ * @class ShardController
+ * @brief This class coordinates shard worker processes to find suspicious pairs in a corpus.
+ */
+class ShardController {
+    private:
+        const static size_t TILE;
+        const static size_t RETRIES;
+
+        std::unique_ptr<CFGWorkerPool> workers;
+        ShardReport report;
+
+    public:
+        ShardController(const std::vector<std::string>&, size_t);
+        ~ShardController();
+        void useBudget(const ExtractionBudget&);
+        std::vector<SimilarityPair> getSuspiciousPairs(const std::vector<std::filesystem::path>&, double);
+        const ShardReport& getReport() const;
+};
+
+
+/**
+ * @brief Constructor that starts the shard workers.
+ * @param command Worker argv, a process running ShardWorkerController::serve
+ * @param size Number of worker processes
+ * @throws std::runtime_error if a worker cannot be started.
+ */
+ShardController::ShardController(const std::vector<std::string>& command, size_t size) : workers(std::make_unique<CFGWorkerPool>(command, size)) {}
+
+
+/**
+ * @brief Destructor for the ShardController class. Stops the workers.
+ */
+ShardController::~ShardController(){}
+
+
+/**
+ * @brief Kill a worker that goes over a budget on one tile; the tile is retried.
+ * @param budget Per-tile limits
+ */
+void ShardController::useBudget(const ExtractionBudget& budget) {
+    workers->setBudget(budget);
+}
+
+
+/**
+ * @brief Score all pairs of files on the workers, TILE files per tile side.
+ * @param files Corpus files, as the workers see them
+ * @param threshold Minimum similarity to report
+ * @return Pairs (indexes into files) scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> ShardController::getSuspiciousPairs(const std::vector<std::filesystem::path>& files, double threshold) {
+    ShardService shard;
+    return shard.coordinate(files, threshold, *workers, TILE, RETRIES, report);
+}
+
+
+/**
+ * @brief Tiles, retries, failures, pairs scored and time of the last run.
+ */
+const ShardReport& ShardController::getReport() const {
+    return report;
+}
+
+const size_t ShardController::TILE = 256;
+const size_t ShardController::RETRIES = 2;
+
+#endif // SHARDCONTROLLER_H
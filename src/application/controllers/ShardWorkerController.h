@@ -0,0 +1,86 @@
+#ifndef SHARDWORKERCONTROLLER_H
+#define SHARDWORKERCONTROLLER_H
+
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../services/ShardService.h"
+#include "CFGBuilderController.h"
+
+
+/**
+ * @class ShardWorkerController
+ * @brief This class answers the tiles of a ShardController over stdin/stdout.
+ */
+class ShardWorkerController {
+    private:
+        CFGBuilderController cfgBuilderController;
+
+    public:
+        ShardWorkerController();
+        ShardWorkerController(size_t);
+        ~ShardWorkerController();
+        void useCache(const std::filesystem::path&);
+        void useBudget(const ExtractionBudget&);
+        void serve();
+};
+
+
+/**
+ * @brief Constructor for the ShardWorkerController class (one extractor process per file).
+ */
+ShardWorkerController::ShardWorkerController() {}
+
+
+/**
+ * @brief Constructor that keeps resident extractor workers for the files of the tiles.
+ * @param workers Number of tools/AST.py workers
+ */
+ShardWorkerController::ShardWorkerController(size_t workers) : cfgBuilderController(workers) {}
+
+
+/**
+ * @brief Destructor for the ShardWorkerController class.
+ */
+ShardWorkerController::~ShardWorkerController(){}
+
+
+/**
+ * @brief Keep built graphs in an on-disk cache keyed by source content.
+ * @param directory Cache directory
+ */
+void ShardWorkerController::useCache(const std::filesystem::path& directory) {
+    cfgBuilderController.useCache(directory);
+}
+
+
+/**
+ * @brief Kill and skip the extraction of any file that goes over a budget.
+ * @param budget Per-file limits
+ */
+void ShardWorkerController::useBudget(const ExtractionBudget& budget) {
+    cfgBuilderController.useBudget(budget);
+}
+
+
+/**
+ * @brief Answer tiles until the coordinator closes stdin. Responses go to the original
+ *        stdout; anything else printed meanwhile is sent to stderr.
+ * @throws std::runtime_error if stdout cannot be set aside or the coordinator stops reading.
+ */
+void ShardWorkerController::serve() {
+    // Close-on-exec keeps extractor processes from holding the coordinator's pipe open
+    int responses = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+    if (responses < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        throw std::runtime_error("ShardWorkerController: cannot redirect stdout");
+    }
+
+    ShardService shard;
+    shard.serve(STDIN_FILENO, responses, [this](std::filesystem::path& file, GraphArena* arena) {
+        return cfgBuilderController.getGraph(file, arena);
+    });
+    close(responses);
+}
+
+#endif // SHARDWORKERCONTROLLER_H
@@ -0,0 +1,323 @@
+#ifndef BATCHEVALUATIONSERVICE_H
+#define BATCHEVALUATIONSERVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../domain/entities/UGraph.h"
+#include "../../domain/entities/CSRGraph.h"
+#include "../../domain/entities/TransitionVector.h"
+#include "../../domain/entities/EvaluationResult.h"
+#include "../../domain/services/BoundedQueue.h"
+#include "../../domain/services/CorpusArchive.h"
+#include "../../domain/services/GraphArena.h"
+#include "SimilarityService.h"
+
+
+/**
+ * @class BatchEvaluationService
+ * @brief Pipelined evaluation of a dataset laid out as <case>/original, <case>/plagiarized
+ *        and optionally <case>/non-plagiarized. A scanner thread queues parse jobs, a pool of
+ *        parser threads builds the transition matrices, and the calling thread scores each
+ *        file against its case's original and aggregates accuracy as cases complete.
+ *        The same layout can be read from a CorpusArchive instead of a directory.
+ */
+class BatchEvaluationService {
+    private:
+        enum class Kind { ORIGINAL, PLAGIARIZED, NON_PLAGIARIZED };
+
+        struct Case {
+            std::string name;
+            std::vector<std::filesystem::path> originals;
+            std::vector<std::filesystem::path> plagiarized;
+            std::vector<std::filesystem::path> nonPlagiarized;
+        };
+
+        struct Job {
+            size_t caseIndex = 0;
+            Kind kind = Kind::ORIGINAL;
+            std::filesystem::path file;
+        };
+
+        struct Parsed {
+            Job job;
+            bool ok = false;
+            TransitionVector matrix;
+        };
+
+        struct CaseState {
+            CaseResult result;
+            size_t expected = 0;
+            size_t received = 0;
+            bool hasOriginal = false;
+            bool originalFailed = false;
+            TransitionVector original;
+            std::vector<Parsed> pending;
+        };
+
+        const static size_t QUEUE_CAPACITY;
+
+        static std::vector<std::filesystem::path> sourceFiles(const std::filesystem::path&);
+        void score(CaseState&, Parsed&, double);
+        EvaluationSummary run(const std::function<void(const std::function<void(Case&)>&)>&, double, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&, const std::function<void(const CaseResult&)>&, size_t);
+
+    public:
+        BatchEvaluationService();
+        ~BatchEvaluationService();
+        EvaluationSummary evaluate(const std::filesystem::path&, double, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&, const std::function<void(const CaseResult&)>&, size_t = 0);
+        EvaluationSummary evaluate(const CorpusArchive&, double, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&, const std::function<void(const CaseResult&)>&, size_t = 0);
+};
+
+
+/**
+ * @brief Constructor for the BatchEvaluationService class.
+ */
+BatchEvaluationService::BatchEvaluationService(){}
+
+
+/**
+ * @brief Destructor for the BatchEvaluationService class.
+ */
+BatchEvaluationService::~BatchEvaluationService(){}
+
+
+/**
+ * @brief Every regular file below a directory, sorted.
+ * @param directory Directory to walk (missing directories yield no files)
+ * @return Files found
+ */
+std::vector<std::filesystem::path> BatchEvaluationService::sourceFiles(const std::filesystem::path& directory) {
+    std::vector<std::filesystem::path> files;
+    if (!std::filesystem::is_directory(directory)) {
+        return files;
+    }
+
+    for (const auto & file : std::filesystem::recursive_directory_iterator(directory)) {
+        if (file.is_regular_file()) {
+            files.push_back(file.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+
+/**
+ * @brief Score a parsed file against its case's original and count the detection.
+ * @param state Case the file belongs to (its original must be known)
+ * @param parsed Parsed file
+ * @param threshold Similarity from which a pair counts as plagiarism
+ */
+void BatchEvaluationService::score(CaseState& state, Parsed& parsed, double threshold) {
+    CaseResult& result = state.result;
+    if (!parsed.ok || state.originalFailed) {
+        result.errors++;
+        return;
+    }
+
+    SimilarityService similarity;
+    double value = similarity.getSimilarity(state.original, parsed.matrix);
+
+    if (parsed.job.kind == Kind::PLAGIARIZED) {
+        result.plagiarized.push_back(std::make_pair(parsed.job.file, value));
+        result.successPlag += (value >= threshold)? 1 : 0;
+        result.totalPlag++;
+    } else {
+        result.nonPlagiarized.push_back(std::make_pair(parsed.job.file, value));
+        result.successNonPlag += (value < threshold)? 1 : 0;
+        result.totalNonPlag++;
+    }
+}
+
+
+/**
+ * @brief Evaluate a whole dataset.
+ * @param dataset Directory holding one sub-directory per case
+ * @param threshold Similarity from which a pair counts as plagiarism
+ * @param getGraph CFG builder into the given arena, e.g. CFGBuilderController::getGraph (must be thread-safe)
+ * @param onCase Called from the calling thread as each case completes
+ * @param threads Parser threads, 0 for one per core
+ * @return Totals over every case
+ */
+EvaluationSummary BatchEvaluationService::evaluate(const std::filesystem::path& dataset, double threshold, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph, const std::function<void(const CaseResult&)>& onCase, size_t threads) {
+    return run([&dataset](const std::function<void(Case&)>& emit) {
+        std::vector<std::filesystem::path> caseDirectories;
+        for (const auto & testCase : std::filesystem::directory_iterator(dataset)) {
+            if (testCase.is_directory()) caseDirectories.push_back(testCase.path());
+        }
+        std::sort(caseDirectories.begin(), caseDirectories.end());
+
+        for (const std::filesystem::path& directory : caseDirectories) {
+            Case testCase;
+            testCase.name = directory.filename().string();
+            testCase.originals = sourceFiles(directory / "original");
+            testCase.plagiarized = sourceFiles(directory / "plagiarized");
+            testCase.nonPlagiarized = sourceFiles(directory / "non-plagiarized");
+            emit(testCase);
+        }
+    }, threshold, getGraph, onCase, threads);
+}
+
+
+/**
+ * @brief Evaluate a dataset packed with CorpusArchive::pack. Jobs carry archived paths
+ *        ("<case>/original/..."), which getGraph looks up in the archive.
+ * @param archive Packed dataset
+ * @param threshold Similarity from which a pair counts as plagiarism
+ * @param getGraph CFG builder for archived paths, e.g. CFGBuilderController::getGraph (must be thread-safe)
+ * @param onCase Called from the calling thread as each case completes
+ * @param threads Parser threads, 0 for one per core
+ * @return Totals over every case
+ */
+EvaluationSummary BatchEvaluationService::evaluate(const CorpusArchive& archive, double threshold, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph, const std::function<void(const CaseResult&)>& onCase, size_t threads) {
+    return run([&archive](const std::function<void(Case&)>& emit) {
+        // Paths are sorted, so the files of a case are contiguous
+        Case testCase;
+        for (size_t i = 0; i < archive.size(); i++) {
+            std::string_view path = archive.get(i).path;
+            size_t caseEnd = path.find('/');
+            size_t kindEnd = caseEnd == std::string_view::npos ? caseEnd : path.find('/', caseEnd + 1);
+            if (kindEnd == std::string_view::npos) continue;
+
+            if (path.substr(0, caseEnd) != testCase.name) {
+                if (!testCase.name.empty()) emit(testCase);
+                testCase = Case();
+                testCase.name = std::string(path.substr(0, caseEnd));
+            }
+
+            std::string_view kind = path.substr(caseEnd + 1, kindEnd - caseEnd - 1);
+            if (kind == "original") testCase.originals.push_back(std::filesystem::path(path));
+            else if (kind == "plagiarized") testCase.plagiarized.push_back(std::filesystem::path(path));
+            else if (kind == "non-plagiarized") testCase.nonPlagiarized.push_back(std::filesystem::path(path));
+        }
+        if (!testCase.name.empty()) emit(testCase);
+    }, threshold, getGraph, onCase, threads);
+}
+
+
+/**
+ * @brief Run the evaluation pipeline over the cases a scanner lists.
+ * @param scan Hands every case, with its files sorted, to its argument
+ * @param threshold Similarity from which a pair counts as plagiarism
+ * @param getGraph CFG builder into the given arena (must be thread-safe)
+ * @param onCase Called from the calling thread as each case completes
+ * @param threads Parser threads, 0 for one per core
+ * @return Totals over every case
+ */
+EvaluationSummary BatchEvaluationService::run(const std::function<void(const std::function<void(Case&)>&)>& scan, double threshold, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph, const std::function<void(const CaseResult&)>& onCase, size_t threads) {
+    if (!threads) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    BoundedQueue<Job> jobs(QUEUE_CAPACITY);
+    BoundedQueue<Parsed> parsed(QUEUE_CAPACITY);
+    std::deque<CaseState> cases;
+    std::mutex casesLock;
+    EvaluationSummary summary;
+
+    // Stage 1: scanner
+    std::thread scanner([&]() {
+        try {
+            scan([&](Case& testCase) {
+                if (testCase.originals.empty()) return;
+
+                size_t caseIndex;
+                {
+                    std::lock_guard<std::mutex> guard(casesLock);
+                    caseIndex = cases.size();
+                    cases.emplace_back();
+                    cases.back().result.name = testCase.name;
+                    cases.back().result.original = testCase.originals.back();
+                    cases.back().expected = 1 + testCase.plagiarized.size() + testCase.nonPlagiarized.size();
+                }
+
+                jobs.push(Job{caseIndex, Kind::ORIGINAL, testCase.originals.back()});
+                for (const auto& file : testCase.plagiarized) jobs.push(Job{caseIndex, Kind::PLAGIARIZED, file});
+                for (const auto& file : testCase.nonPlagiarized) jobs.push(Job{caseIndex, Kind::NON_PLAGIARIZED, file});
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "Error while scanning the dataset: " << e.what() << std::endl;
+        }
+        jobs.close();
+    });
+
+    // Stage 2: parser pool
+    std::atomic<size_t> activeParsers(threads);
+    std::vector<std::thread> parsers;
+    for (size_t t = 0; t < threads; t++) {
+        parsers.emplace_back([&]() {
+            SimilarityService similarity;
+            GraphArena arena;
+            Job job;
+            while (jobs.pop(job)) {
+                Parsed result;
+                result.job = job;
+                UGraph<std::string>* graph = getGraph(result.job.file, &arena);
+                if (graph) {
+                    result.matrix = similarity.getTransitions(*graph);
+                    result.ok = true;
+                }
+                arena.release();
+                parsed.push(std::move(result));
+            }
+            if (--activeParsers == 0) {
+                parsed.close();
+            }
+        });
+    }
+
+    // Stage 3 and 4: similarity and aggregation
+    Parsed next;
+    while (parsed.pop(next)) {
+        CaseState* state;
+        {
+            std::lock_guard<std::mutex> guard(casesLock);
+            state = &cases[next.job.caseIndex];
+        }
+
+        if (next.job.kind == Kind::ORIGINAL) {
+            state->hasOriginal = true;
+            state->originalFailed = !next.ok;
+            state->original = std::move(next.matrix);
+            state->result.errors += next.ok? 0 : 1;
+            for (Parsed& waiting : state->pending) {
+                score(*state, waiting, threshold);
+            }
+            state->pending.clear();
+        } else if (state->hasOriginal) {
+            score(*state, next, threshold);
+        } else {
+            state->pending.push_back(std::move(next));
+        }
+
+        if (++state->received == state->expected) {
+            const CaseResult& result = state->result;
+            summary.cases++;
+            summary.successPlag += result.successPlag;
+            summary.totalPlag += result.totalPlag;
+            summary.successNonPlag += result.successNonPlag;
+            summary.totalNonPlag += result.totalNonPlag;
+            summary.errors += result.errors;
+            onCase(result);
+
+            state->original = TransitionVector();
+        }
+    }
+
+    scanner.join();
+    for (std::thread& parser : parsers) {
+        parser.join();
+    }
+
+    return summary;
+}
+
+const size_t BatchEvaluationService::QUEUE_CAPACITY = 256;
+
+#endif // BATCHEVALUATIONSERVICE_H
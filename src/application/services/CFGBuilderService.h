@@ -2,28 +2,54 @@
 #define CFGBUILDERSERVICE_H
 
 #include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 #include <stack>
 #include <iterator>
 #include <set>
 #include "../../domain/entities/UGraph.h"
+#include "../../domain/entities/ExtractionBudget.h"
 #include "../../domain/services/CommandExecutor.h"
-#include "../../domain/services/StringService.h"
+#include "../../domain/services/CFGStreamParser.h"
+#include "../../domain/services/CFGWorkerPool.h"
+#include "../../domain/services/GraphArena.h"
+#include "../../domain/services/HashService.h"
+#include "../../domain/services/Metrics.h"
+#ifdef NATIVE_CFG
+#include "../../domain/services/TreeSitterCFGBuilder.h"
+#endif
 
 
 /**
  * @class CFGBuilderService
  * @brief This class builds an CFG from a given AST.
+ *        Spawned extractors are held to an ExtractionBudget; resident workers get theirs from
+ *        CFGWorkerPool::setBudget, and in-process builds only honor the wall-clock budget.
  */
 class CFGBuilderService {
     private:
         const static std::filesystem::path PARSER;
         const static std::filesystem::path JAVA;
-        const static std::filesystem::path TEMP_DIR;
+
+        ExtractionBudget budget;
+
+        UGraph<std::string>* parse(const std::function<void(const std::function<void(const char*, size_t)>&)>&, GraphArena*);
+        void feed(const std::function<void(const std::function<void(const char*, size_t)>&)>&, CFGStreamParser&);
     
     public:
         CFGBuilderService();
+        CFGBuilderService(const ExtractionBudget&);
         ~CFGBuilderService();
-        UGraph<std::string>* build(std::filesystem::path &);
+        UGraph<std::string>* build(std::filesystem::path &, GraphArena* = nullptr);
+        UGraph<std::string>* build(std::filesystem::path &, CFGWorkerPool&, GraphArena* = nullptr);
+        UGraph<std::string>* buildSource(std::string_view, GraphArena* = nullptr);
+        UGraph<std::string>* buildSource(std::string_view, CFGWorkerPool&, GraphArena* = nullptr);
+        std::vector<CFGStreamParser::Method> buildMethods(std::filesystem::path &);
+        std::vector<CFGStreamParser::Method> buildMethods(std::filesystem::path &, CFGWorkerPool&, const std::vector<std::string>&);
+        static std::shared_ptr<CFGWorkerPool> startWorkers(size_t);
+        static std::string cacheSalt();
 };
 
 
@@ -33,6 +59,13 @@ class CFGBuilderService {
 CFGBuilderService::CFGBuilderService(){}
 
 
+/**
+ * @brief Constructor for a CFGBuilderService that kills and skips extractions over budget.
+ * @param budget Per-file limits
+ */
+CFGBuilderService::CFGBuilderService(const ExtractionBudget& budget) : budget(budget) {}
+
+
 /**
  * @brief Destructor for the CFGBuilderService class.
  */
@@ -40,50 +73,225 @@ CFGBuilderService::~CFGBuilderService(){}
 
 
 /**
- * @brief Construct CFG from AST
+ * @brief Construct CFG from AST.
+ *        Built with -DNATIVE_CFG the CFG is built in-process by TreeSitterCFGBuilder,
+ *        otherwise tools/AST.py is spawned for each file.
  * @param tree input AST
+ * @param arena Arena that owns the graph, nullptr for a graph owned (and deleted) by the caller
  * @return Resulting UGraph
  */
-UGraph<std::string>* CFGBuilderService::build(std::filesystem::path &sourceCode) {
-    std::map<int, std::pair<int, std::string>> vertexes;
-    std::ifstream input;
-    std::string nextLine;
+UGraph<std::string>* CFGBuilderService::build(std::filesystem::path &sourceCode, GraphArena* arena) {
+#ifdef NATIVE_CFG
+    try {
+        Metrics::Timer timer(Metrics::EXTRACT);
+        TreeSitterCFGBuilder builder;
+        builder.setTimeout(budget.wallSeconds);
+        return builder.build(sourceCode, JAVA, "java", arena);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return nullptr;
+    }
+#endif
     std::string language = "java";
     std::string grammar = JAVA.string();
-    std::string command = "python3 " + PARSER.string() + " " + language + " " + grammar + " " + sourceCode.string();
-    std::string graphConnections = CommandExecutor::execute(command);
-    std::filesystem::path outputLocation = TEMP_DIR / "output.txt";
+    std::string command = "python3 " + PARSER.string() + " " + language + " " + grammar + " " + sourceCode.string() + " --binary";
 
-    UGraph<std::string>* graph = new UGraph<std::string>(true);
+    // Load python's output straight from the pipe (binary, or text from an older extractor)
+    return parse([this, &command](const std::function<void(const char*, size_t)>& consumer) {
+        CommandExecutor::stream(command, consumer, budget);
+    }, arena);
+}
 
-    // Open output file created by python
-    input.open(outputLocation.c_str(), std::ios::in);
 
-    if (input.fail()) {
-        std::cout << "El archivo no se pudo abrir" << std::endl;
+/**
+ * @brief Construct CFG on a resident extractor worker instead of spawning one.
+ * @param sourceCode File to analyze
+ * @param workers Pool created by startWorkers
+ * @param arena Arena that owns the graph, nullptr for a graph owned (and deleted) by the caller
+ * @return Resulting UGraph, nullptr if the extraction failed
+ */
+UGraph<std::string>* CFGBuilderService::build(std::filesystem::path &sourceCode, CFGWorkerPool& workers, GraphArena* arena) {
+    std::string file = std::filesystem::absolute(sourceCode).string();
+    return parse([&workers, &file](const std::function<void(const char*, size_t)>& consumer) {
+        workers.request(file, consumer);
+    }, arena);
+}
+
+
+/**
+ * @brief Construct the CFG of source code held in memory, e.g. a file of a CorpusArchive.
+ *        Only in-process builds (-DNATIVE_CFG) can do without resident workers: a spawned
+ *        tools/AST.py needs a file to read.
+ * @param source Source bytes
+ * @param arena Arena that owns the graph, nullptr for a graph owned (and deleted) by the caller
+ * @return Resulting UGraph, nullptr if the extraction failed
+ */
+UGraph<std::string>* CFGBuilderService::buildSource(std::string_view source, GraphArena* arena) {
+#ifdef NATIVE_CFG
+    try {
+        Metrics::Timer timer(Metrics::EXTRACT);
+        TreeSitterCFGBuilder builder;
+        builder.setTimeout(budget.wallSeconds);
+        return builder.buildSource(source, JAVA, "java", arena);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
         return nullptr;
     }
+#else
+    (void) source;
+    (void) arena;
+    std::cout << "CFGBuilderService: archived sources need resident extractor workers" << std::endl;
+    return nullptr;
+#endif
+}
 
-    std::vector<std::string> aux;
-    std::getline(input, nextLine); // Ignore text "Nodes in CFG 1:"
 
-    while (std::getline(input, nextLine) && nextLine != "") {
-        aux = StringService::divideInTwo(nextLine, ' ');
-        vertexes[stoi(aux[0])] = std::make_pair(stoi(aux[0]), aux[1]);
-    }
-    
-    std::getline(input, nextLine); // Ignore text Edges in CFG":"
-    while (std::getline(input, nextLine) && nextLine != "\n") {
-        aux = StringService::divideInTwo(nextLine, ' ');
-        graph->addEdge(vertexes[stoi(aux[0])],vertexes[stoi(aux[1])]);
+/**
+ * @brief Construct the CFG of source code held in memory on a resident worker. The source
+ *        travels in the request itself, after a NUL byte that no path can start with.
+ * @param source Source bytes
+ * @param workers Pool created by startWorkers
+ * @param arena Arena that owns the graph, nullptr for a graph owned (and deleted) by the caller
+ * @return Resulting UGraph, nullptr if the extraction failed
+ */
+UGraph<std::string>* CFGBuilderService::buildSource(std::string_view source, CFGWorkerPool& workers, GraphArena* arena) {
+    std::string request(1, '\0');
+    request.append(source);
+    return parse([&workers, &request](const std::function<void(const char*, size_t)>& consumer) {
+        workers.request(request, consumer);
+    }, arena);
+}
+
+
+/**
+ * @brief Extract the sub-CFG of every method of a file, in-process with -DNATIVE_CFG,
+ *        otherwise with a new tools/AST.py process.
+ * @param sourceCode File to analyze
+ * @throws std::runtime_error if the extraction fails.
+ * @return Methods of the file, in source order
+ */
+std::vector<CFGStreamParser::Method> CFGBuilderService::buildMethods(std::filesystem::path &sourceCode) {
+#ifdef NATIVE_CFG
+    Metrics::Timer timer(Metrics::EXTRACT);
+    TreeSitterCFGBuilder builder;
+    builder.setTimeout(budget.wallSeconds);
+    return builder.buildMethods(sourceCode, JAVA, "java");
+#else
+    std::string command = "python3 " + PARSER.string() + " java " + JAVA.string() + " " + sourceCode.string();
+    CFGStreamParser parser(nullptr);
+    feed([this, &command](const std::function<void(const char*, size_t)>& consumer) {
+        CommandExecutor::stream(command, consumer, budget);
+    }, parser);
+    return std::move(parser.getMethods());
+#endif
+}
+
+
+/**
+ * @brief Extract the sub-CFG of every method of a file on a resident worker, skipping the
+ *        methods whose hash the caller already knows (they come back marked cached).
+ * @param sourceCode File to analyze
+ * @param workers Pool created by startWorkers
+ * @param known Hashes of the methods the caller already has
+ * @throws std::runtime_error if the extraction fails.
+ * @return Methods of the file, in source order
+ */
+std::vector<CFGStreamParser::Method> CFGBuilderService::buildMethods(std::filesystem::path &sourceCode, CFGWorkerPool& workers, const std::vector<std::string>& known) {
+    std::string request = std::filesystem::absolute(sourceCode).string() + "\n";
+    for (const std::string& hash : known) {
+        request += hash + " ";
     }
 
-    input.close();
+    CFGStreamParser parser(nullptr);
+    feed([&workers, &request](const std::function<void(const char*, size_t)>& consumer) {
+        workers.request(request, consumer);
+    }, parser);
+    return std::move(parser.getMethods());
+}
+
+
+/**
+ * @brief Feed an extractor's output to a CFGStreamParser as it arrives, in either wire format.
+ * @param extract Runs the extractor, handing every chunk of output to its argument
+ * @param arena Arena that owns the graph, nullptr for a graph owned by the caller
+ * @return Resulting UGraph, nullptr if the extraction failed
+ */
+UGraph<std::string>* CFGBuilderService::parse(const std::function<void(const std::function<void(const char*, size_t)>&)>& extract, GraphArena* arena) {
+    UGraph<std::string>* graph = GraphArena::create(arena, true);
+    CFGStreamParser parser(graph);
 
+    try {
+        feed(extract, parser);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        GraphArena::discard(arena, graph);
+        return nullptr;
+    }
     return graph;
 }
+
+
+/**
+ * @brief Run an extractor into a parser.
+ *        Time spent parsing is recorded as the parse stage, the rest as the extract stage.
+ * @param extract Runs the extractor, handing every chunk of output to its argument
+ * @param parser Parser that receives the output
+ * @throws std::runtime_error if the extraction or the parsing fails.
+ */
+void CFGBuilderService::feed(const std::function<void(const std::function<void(const char*, size_t)>&)>& extract, CFGStreamParser& parser) {
+    uint64_t start = Metrics::now();
+    uint64_t parsing = 0;
+
+    extract([&parser, &parsing](const char* data, size_t size) {
+        uint64_t begin = Metrics::now();
+        parser.feed(data, size);
+        parsing += Metrics::now() - begin;
+    });
+    uint64_t begin = Metrics::now();
+    parser.finish();
+    parsing += Metrics::now() - begin;
+
+    Metrics::record(Metrics::EXTRACT, Metrics::now() - start - parsing);
+    Metrics::record(Metrics::PARSE, parsing);
+}
+
+
+/**
+ * @brief Start resident tools/AST.py workers that load the grammar once and serve many files.
+ *        Whole-file CFGs come back in the binary format, method-level requests as text.
+ * @param size Number of workers
+ * @return Pool to pass to build
+ */
+std::shared_ptr<CFGWorkerPool> CFGBuilderService::startWorkers(size_t size) {
+    std::vector<std::string> command = {"python3", PARSER.string(), "java", JAVA.string(), "--worker", "--binary"};
+    return std::make_shared<CFGWorkerPool>(command, size);
+}
+
+/**
+ * @brief Identity of the grammar and extractor that build() uses, for cache keys.
+ *        Changes whenever the grammar library or tools/AST.py change.
+ * @return Salt string
+ */
+std::string CFGBuilderService::cacheSalt() {
+    std::string salt;
+    std::vector<std::filesystem::path> inputs = {JAVA};
+#ifdef NATIVE_CFG
+    salt = "native:1";
+#else
+    salt = "python:1";
+    inputs.push_back(PARSER);
+#endif
+
+    for (const std::filesystem::path& input : inputs) {
+        std::ifstream file(input, std::ios::in | std::ios::binary);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        salt += ":" + HashService::digest(buffer.str());
+    }
+    return salt;
+}
+
 const std::filesystem::path CFGBuilderService::PARSER = "tools/AST.py";
 const std::filesystem::path CFGBuilderService::JAVA = "./domain/entities/grammars/java.so";
-const std::filesystem::path CFGBuilderService::TEMP_DIR = std::filesystem::temp_directory_path();
 
 #endif // CFGBUILDERSERVICE_H
\ No newline at end of file
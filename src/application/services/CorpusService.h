@@ -0,0 +1,421 @@
+#ifndef CORPUSSERVICE_H
+#define CORPUSSERVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../../domain/entities/UGraph.h"
+#include "../../domain/entities/CSRGraph.h"
+#include "../../domain/entities/TransitionVector.h"
+#include "../../domain/entities/SimilarityPair.h"
+#include "../../domain/services/MinHashIndex.h"
+#include "../../domain/services/GraphFingerprint.h"
+#include "../../domain/services/CFGCache.h"
+#include "../../domain/services/ScoreStore.h"
+#include "../../domain/services/GraphArena.h"
+#include "SimilarityService.h"
+
+
+/**
+ * @class CorpusService
+ * @brief This class scores every pair of files of a corpus.
+ *        Each file's transition matrix is built once and pairs are scored in parallel tiles.
+ *        Files with equal Weisfeiler-Lehman fingerprints can be scored once per group, and
+ *        with a ScoreStore, pairs scored by an earlier run are read back instead of rescored.
+ */
+class CorpusService {
+    private:
+        const static size_t TILE;
+        const static size_t FINGERPRINT_LEVELS;
+        const static size_t PREFILTER_LEVEL;
+
+        ScoreStore* store;
+        std::vector<uint64_t> contentKeys;
+
+        static size_t defaultThreads(size_t);
+        std::vector<TransitionVector> build(std::vector<std::filesystem::path>&, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&, std::vector<GraphFingerprint>*, size_t);
+        std::vector<SimilarityPair> compareTriangle(const std::vector<TransitionVector>&, const std::vector<size_t>&, const std::vector<GraphFingerprint>*, double, double, size_t);
+        std::vector<SimilarityPair> scorePairs(const std::vector<std::pair<size_t, size_t>>&, const std::vector<TransitionVector>&, const std::vector<TransitionVector>&, double, size_t);
+
+    public:
+        CorpusService();
+        ~CorpusService();
+        void useStore(ScoreStore*);
+        static void sortPairs(std::vector<SimilarityPair>&);
+        std::vector<TransitionVector> prepare(std::vector<std::filesystem::path>&, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&, size_t = 0);
+        std::vector<TransitionVector> prepare(std::vector<std::filesystem::path>&, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&, std::vector<GraphFingerprint>&, size_t = 0);
+        std::vector<SimilarityPair> compareAll(const std::vector<TransitionVector>&, double, size_t = 0);
+        std::vector<SimilarityPair> compareUnique(const std::vector<TransitionVector>&, const std::vector<GraphFingerprint>&, double, double = 0.0, size_t = 0);
+        void index(const std::vector<TransitionVector>&, MinHashIndex&);
+        std::vector<SimilarityPair> compareCandidates(const std::vector<TransitionVector>&, double, MinHashIndex&, size_t = 0);
+        std::vector<SimilarityPair> compareAgainst(const std::vector<TransitionVector>&, const std::vector<TransitionVector>&, const MinHashIndex&, double, size_t = 0);
+};
+
+
+/**
+ * @brief Constructor for the CorpusService class.
+ */
+CorpusService::CorpusService() : store(nullptr) {}
+
+
+/**
+ * @brief Destructor for the CorpusService class.
+ */
+CorpusService::~CorpusService(){}
+
+
+/**
+ * @brief Memoize pair scores in a store. The files of the next prepare are keyed by content,
+ *        and compareAll/compareUnique over its matrices only score the pairs the store lacks.
+ * @param scores Store outliving the comparisons, nullptr to score every pair
+ */
+void CorpusService::useStore(ScoreStore* scores) {
+    store = scores;
+}
+
+
+/**
+ * @brief Resolve a thread count, 0 meaning one per core.
+ */
+size_t CorpusService::defaultThreads(size_t threads) {
+    if (threads) return threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+/**
+ * @brief Build the CFG and transition matrix of every file, in parallel.
+ *        Each thread builds its graphs in its own GraphArena, released as soon as the matrix exists.
+ * @param files Corpus files
+ * @param getGraph CFG builder into the given arena, e.g. CFGBuilderController::getGraph
+ * @param threads Number of threads, 0 for one per core
+ * @return One matrix per file (empty for files that failed to build)
+ */
+std::vector<TransitionVector> CorpusService::prepare(std::vector<std::filesystem::path>& files, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph, size_t threads) {
+    return build(files, getGraph, nullptr, threads);
+}
+
+
+/**
+ * @brief Build the transition matrix and the Weisfeiler-Lehman fingerprint of every file, in parallel.
+ * @param files Corpus files
+ * @param getGraph CFG builder into the given arena, e.g. CFGBuilderController::getGraph
+ * @param fingerprints Filled with one fingerprint per file (empty fingerprint for files that failed to build)
+ * @param threads Number of threads, 0 for one per core
+ * @return One matrix per file (empty for files that failed to build)
+ */
+std::vector<TransitionVector> CorpusService::prepare(std::vector<std::filesystem::path>& files, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph, std::vector<GraphFingerprint>& fingerprints, size_t threads) {
+    return build(files, getGraph, &fingerprints, threads);
+}
+
+
+/**
+ * @brief Shared body of both prepare overloads; fingerprints are skipped when null.
+ */
+std::vector<TransitionVector> CorpusService::build(std::vector<std::filesystem::path>& files, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph, std::vector<GraphFingerprint>* fingerprints, size_t threads) {
+    std::vector<TransitionVector> matrices(files.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    if (fingerprints) {
+        fingerprints->assign(files.size(), GraphFingerprint());
+    }
+    contentKeys.assign(store ? files.size() : 0, 0);
+
+    for (size_t t = 0; t < std::min(defaultThreads(threads), files.size()); t++) {
+        workers.emplace_back([&]() {
+            SimilarityService similarity;
+            GraphArena arena;
+            for (size_t i = next++; i < files.size(); i = next++) {
+                UGraph<std::string>* graph = getGraph(files[i], &arena);
+                if (graph) {
+                    CSRGraph frozen = similarity.freeze(*graph);
+                    matrices[i] = similarity.getTransitions(frozen);
+                    if (fingerprints) {
+                        Metrics::Timer timer(Metrics::FINGERPRINT);
+                        (*fingerprints)[i] = GraphFingerprint(frozen, FINGERPRINT_LEVELS);
+                    }
+                    if (store && matrices[i].nonZeros()) {
+                        try {
+                            contentKeys[i] = ScoreStore::contentKey(CFGCache::readFile(files[i]));
+                        } catch (const std::exception& e) {
+                            contentKeys[i] = 0;
+                        }
+                    }
+                }
+                arena.release();
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    return matrices;
+}
+
+
+/**
+ * @brief Score the upper triangle of the corpus similarity matrix.
+ * @param matrices Transition matrices from prepare
+ * @param threshold Minimum score reported
+ * @param threads Number of threads, 0 for one per core
+ * @return Pairs scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusService::compareAll(const std::vector<TransitionVector>& matrices, double threshold, size_t threads) {
+    std::vector<size_t> ids(matrices.size());
+    for (size_t i = 0; i < ids.size(); i++) ids[i] = i;
+    std::vector<SimilarityPair> result = compareTriangle(matrices, ids, nullptr, threshold, 0.0, threads);
+    sortPairs(result);
+    return result;
+}
+
+
+/**
+ * @brief Score the upper triangle once per group of files with equal fingerprints.
+ *        Only the first file of each group is scored; its pairs are copied to the other
+ *        members, which have the same transition matrix (see GraphFingerprint), so the
+ *        result is the one compareAll gives.
+ *        With minOverlap > 0, pairs whose level PREFILTER_LEVEL histograms overlap less are
+ *        skipped before scoring (a heuristic: a skipped pair might have passed).
+ * @param matrices Transition matrices from prepare
+ * @param fingerprints Fingerprints from prepare, one per matrix
+ * @param threshold Minimum score reported
+ * @param minOverlap Minimum histogram overlap (GraphFingerprint::overlap) of a scored pair, 0 to score every pair
+ * @param threads Number of threads, 0 for one per core
+ * @return Pairs scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusService::compareUnique(const std::vector<TransitionVector>& matrices, const std::vector<GraphFingerprint>& fingerprints, double threshold, double minOverlap, size_t threads) {
+    std::unordered_map<GraphFingerprint, size_t, GraphFingerprint::Hasher> groupOf;
+    std::vector<std::vector<size_t>> groups;
+    std::vector<size_t> representatives;
+
+    for (size_t i = 0; i < matrices.size(); i++) {
+        auto inserted = groupOf.emplace(fingerprints[i], groups.size());
+        if (inserted.second) {
+            groups.emplace_back();
+            representatives.push_back(i);
+        }
+        groups[inserted.first->second].push_back(i);
+    }
+    Metrics::add(Metrics::DUPLICATES, matrices.size() - groups.size());
+
+    std::vector<SimilarityPair> scored = compareTriangle(matrices, representatives, &fingerprints, threshold, minOverlap, threads);
+    std::vector<SimilarityPair> result;
+    for (const SimilarityPair& pair : scored) {
+        for (size_t first : groups[groupOf[fingerprints[pair.first]]]) {
+            for (size_t second : groups[groupOf[fingerprints[pair.second]]]) {
+                result.push_back(SimilarityPair{std::min(first, second), std::max(first, second), pair.score});
+            }
+        }
+    }
+
+    // Members of a group score against each other like the representative against itself
+    SimilarityService similarity;
+    for (const std::vector<size_t>& group : groups) {
+        if (group.size() < 2) continue;
+        double score = similarity.similarityAtLeast(matrices[group[0]], matrices[group[0]], threshold);
+        if (score < threshold) continue;
+        for (size_t a = 0; a < group.size(); a++) {
+            for (size_t b = a + 1; b < group.size(); b++) {
+                result.push_back(SimilarityPair{group[a], group[b], score});
+            }
+        }
+    }
+
+    sortPairs(result);
+    return result;
+}
+
+
+/**
+ * @brief Score every pair of a subset of the matrices.
+ *        The triangle is cut into TILE x TILE blocks that threads claim one at a time.
+ *        Pairs found in the store are not scored; new scores are appended once per thread.
+ * @param matrices Transition matrices from prepare
+ * @param ids Indexes of the matrices to compare, ascending
+ * @param fingerprints Fingerprints of the matrices for the pre-filter, nullptr to score every pair
+ * @param threshold Minimum score reported
+ * @param minOverlap Minimum histogram overlap of a scored pair
+ * @param threads Number of threads, 0 for one per core
+ * @return Pairs (indexes into matrices) scoring at least threshold, unsorted
+ */
+std::vector<SimilarityPair> CorpusService::compareTriangle(const std::vector<TransitionVector>& matrices, const std::vector<size_t>& ids, const std::vector<GraphFingerprint>* fingerprints, double threshold, double minOverlap, size_t threads) {
+    size_t blocks = (ids.size() + TILE - 1) / TILE;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t bi = 0; bi < blocks; bi++) {
+        for (size_t bj = bi; bj < blocks; bj++) {
+            tiles.push_back(std::make_pair(bi, bj));
+        }
+    }
+    bool prefilter = fingerprints && minOverlap > 0.0;
+    bool memoize = store && contentKeys.size() == matrices.size();
+
+    std::vector<SimilarityPair> result;
+    std::mutex merge;
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < std::min(defaultThreads(threads), tiles.size()); t++) {
+        workers.emplace_back([&]() {
+            SimilarityService similarity;
+            std::vector<SimilarityPair> local;
+            std::vector<ScoreStore::Score> scored;
+            uint64_t filtered = 0, reused = 0;
+
+            for (size_t k = next++; k < tiles.size(); k = next++) {
+                size_t iEnd = std::min(ids.size(), (tiles[k].first + 1) * TILE);
+                size_t jEnd = std::min(ids.size(), (tiles[k].second + 1) * TILE);
+
+                for (size_t i = tiles[k].first * TILE; i < iEnd; i++) {
+                    for (size_t j = std::max(i + 1, tiles[k].second * TILE); j < jEnd; j++) {
+                        uint64_t first = memoize ? contentKeys[ids[i]] : 0;
+                        uint64_t second = memoize ? contentKeys[ids[j]] : 0;
+                        double score;
+                        if (first && second && store->get(first, second, threshold, score)) {
+                            reused++;
+                        } else if (prefilter && (*fingerprints)[ids[i]].overlap((*fingerprints)[ids[j]], PREFILTER_LEVEL) < minOverlap) {
+                            filtered++;
+                            continue;
+                        } else {
+                            score = similarity.similarityAtLeast(matrices[ids[i]], matrices[ids[j]], threshold);
+                            if (first && second) {
+                                scored.push_back(ScoreStore::Score{first, second, score, threshold});
+                            }
+                        }
+                        if (score >= threshold) {
+                            local.push_back(SimilarityPair{ids[i], ids[j], score});
+                        }
+                    }
+                }
+            }
+            Metrics::add(Metrics::PAIRS_FILTERED, filtered);
+            Metrics::add(Metrics::SCORES_REUSED, reused);
+            if (memoize) {
+                store->put(scored);
+                Metrics::add(Metrics::SCORES_STORED, scored.size());
+            }
+
+            std::lock_guard<std::mutex> guard(merge);
+            result.insert(result.end(), local.begin(), local.end());
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    return result;
+}
+
+
+/**
+ * @brief Rank pairs, most similar first.
+ */
+void CorpusService::sortPairs(std::vector<SimilarityPair>& pairs) {
+    std::sort(pairs.begin(), pairs.end(), [](const SimilarityPair& a, const SimilarityPair& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return std::make_pair(a.first, a.second) < std::make_pair(b.first, b.second);
+    });
+}
+
+
+/**
+ * @brief Exact Markov cosine of a list of pairs, in parallel.
+ * @param pairs Indexes into first and second
+ * @param first Matrices referenced by pair.first
+ * @param second Matrices referenced by pair.second
+ * @param threshold Minimum score reported
+ * @param threads Number of threads, 0 for one per core
+ * @return Pairs scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusService::scorePairs(const std::vector<std::pair<size_t, size_t>>& pairs, const std::vector<TransitionVector>& first, const std::vector<TransitionVector>& second, double threshold, size_t threads) {
+    std::vector<SimilarityPair> result;
+    std::mutex merge;
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    const size_t chunk = TILE * TILE;
+
+    for (size_t t = 0; t < std::min(defaultThreads(threads), (pairs.size() + chunk - 1) / chunk); t++) {
+        workers.emplace_back([&]() {
+            SimilarityService similarity;
+            std::vector<SimilarityPair> local;
+
+            for (size_t begin = next.fetch_add(chunk); begin < pairs.size(); begin = next.fetch_add(chunk)) {
+                for (size_t k = begin; k < std::min(pairs.size(), begin + chunk); k++) {
+                    double score = similarity.similarityAtLeast(first[pairs[k].first], second[pairs[k].second], threshold);
+                    if (score >= threshold) {
+                        local.push_back(SimilarityPair{pairs[k].first, pairs[k].second, score});
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(merge);
+            result.insert(result.end(), local.begin(), local.end());
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    sortPairs(result);
+    return result;
+}
+
+
+/**
+ * @brief Add the MinHash signature of every matrix to an index; ids follow the vector order.
+ * @param matrices Transition matrices from prepare
+ * @param minHash Index to fill
+ */
+void CorpusService::index(const std::vector<TransitionVector>& matrices, MinHashIndex& minHash) {
+    for (const TransitionVector& matrix : matrices) {
+        minHash.add(minHash.sketch(matrix));
+    }
+}
+
+
+/**
+ * @brief Score only the pairs that share an LSH bucket instead of the whole triangle.
+ * @param matrices Transition matrices from prepare
+ * @param threshold Minimum score reported
+ * @param minHash Empty index configured with the recall/speed trade-off
+ * @param threads Number of threads, 0 for one per core
+ * @return Candidate pairs scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusService::compareCandidates(const std::vector<TransitionVector>& matrices, double threshold, MinHashIndex& minHash, size_t threads) {
+    index(matrices, minHash);
+    return scorePairs(minHash.candidatePairs(), matrices, matrices, threshold, threads);
+}
+
+
+/**
+ * @brief Score new files only against the archived files they share an LSH bucket with.
+ * @param queries Transition matrices of the new files
+ * @param archive Transition matrices of the archive
+ * @param archiveIndex Index filled by index(archive, ...)
+ * @param threshold Minimum score reported
+ * @param threads Number of threads, 0 for one per core
+ * @return Pairs (query index, archive index) scoring at least threshold, most similar first
+ */
+std::vector<SimilarityPair> CorpusService::compareAgainst(const std::vector<TransitionVector>& queries, const std::vector<TransitionVector>& archive, const MinHashIndex& archiveIndex, double threshold, size_t threads) {
+    std::vector<std::pair<size_t, size_t>> pairs;
+
+    for (size_t i = 0; i < queries.size(); i++) {
+        for (size_t j : archiveIndex.query(archiveIndex.sketch(queries[i]))) {
+            pairs.push_back(std::make_pair(i, j));
+        }
+    }
+    return scorePairs(pairs, queries, archive, threshold, threads);
+}
+
+const size_t CorpusService::TILE = 64;
+const size_t CorpusService::FINGERPRINT_LEVELS = 3;
+const size_t CorpusService::PREFILTER_LEVEL = 1;
+
+#endif // CORPUSSERVICE_H
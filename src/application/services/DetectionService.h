@@ -0,0 +1,155 @@
+#ifndef DETECTIONSERVICE_H
+#define DETECTIONSERVICE_H
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../domain/entities/UGraph.h"
+#include "../../domain/entities/TransitionVector.h"
+#include "../../domain/services/GraphArena.h"
+#include "CorpusService.h"
+#include "SimilarityService.h"
+
+
+/**
+ * @class DetectionService
+ * @brief Keeps the transition matrices of every assignment's reference files in memory
+ *        and scores submissions against them. Assignments can be (re)loaded while other
+ *        threads score: a reload swaps in a complete new set of references.
+ */
+class DetectionService {
+    private:
+        struct Assignment {
+            std::vector<std::filesystem::path> files;
+            std::vector<TransitionVector> matrices;
+        };
+
+        mutable std::shared_mutex lock;
+        std::map<std::string, std::shared_ptr<const Assignment>> assignments;
+
+        std::shared_ptr<const Assignment> find(const std::string&) const;
+
+    public:
+        DetectionService();
+        ~DetectionService();
+        size_t load(const std::string&, const std::filesystem::path&, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&);
+        std::vector<std::pair<std::string, size_t>> getAssignments() const;
+        void checkLoaded(const std::string&) const;
+        std::vector<std::pair<std::filesystem::path, double>> score(const std::string&, const TransitionVector&) const;
+};
+
+
+/**
+ * @brief Constructor for the DetectionService class.
+ */
+DetectionService::DetectionService(){}
+
+
+/**
+ * @brief Destructor for the DetectionService class.
+ */
+DetectionService::~DetectionService(){}
+
+
+/**
+ * @brief Build and keep the references of an assignment, replacing any previous ones.
+ * @param name Assignment name
+ * @param directory Directory holding the reference .java files (searched recursively)
+ * @param getGraph CFG builder into the given arena, e.g. CFGBuilderController::getGraph
+ * @throws std::runtime_error if the directory holds no .java file.
+ * @return Number of references that could be built
+ */
+size_t DetectionService::load(const std::string& name, const std::filesystem::path& directory, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph) {
+    std::vector<std::filesystem::path> files;
+    for (const auto & file : std::filesystem::recursive_directory_iterator(directory)) {
+        if (file.is_regular_file() && file.path().extension() == ".java") {
+            files.push_back(file.path());
+        }
+    }
+    if (files.empty()) {
+        throw std::runtime_error("no .java files in " + directory.string());
+    }
+    std::sort(files.begin(), files.end());
+
+    CorpusService corpus;
+    std::vector<TransitionVector> matrices = corpus.prepare(files, getGraph);
+
+    auto assignment = std::make_shared<Assignment>();
+    for (size_t i = 0; i < files.size(); i++) {
+        if (matrices[i].nonZeros() == 0) continue;
+        assignment->files.push_back(files[i]);
+        assignment->matrices.push_back(std::move(matrices[i]));
+    }
+
+    std::unique_lock<std::shared_mutex> guard(lock);
+    assignments[name] = assignment;
+    return assignment->files.size();
+}
+
+
+/**
+ * @brief References of an assignment.
+ * @throws std::runtime_error if the assignment is not loaded.
+ */
+std::shared_ptr<const DetectionService::Assignment> DetectionService::find(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    auto it = assignments.find(name);
+    if (it == assignments.end()) {
+        throw std::runtime_error("unknown assignment " + name);
+    }
+    return it->second;
+}
+
+
+/**
+ * @brief Fail before a submission is analyzed when its assignment is not loaded.
+ * @throws std::runtime_error if the assignment is not loaded.
+ */
+void DetectionService::checkLoaded(const std::string& name) const {
+    find(name);
+}
+
+
+/**
+ * @brief Loaded assignments.
+ * @return Name and number of references of each assignment
+ */
+std::vector<std::pair<std::string, size_t>> DetectionService::getAssignments() const {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    std::vector<std::pair<std::string, size_t>> result;
+    for (const auto& assignment : assignments) {
+        result.push_back(std::make_pair(assignment.first, assignment.second->files.size()));
+    }
+    return result;
+}
+
+
+/**
+ * @brief Score a submission against every reference of an assignment.
+ * @param name Assignment name
+ * @param submission Transition matrix of the submitted file
+ * @throws std::runtime_error if the assignment is not loaded.
+ * @return Reference files with their similarity, most similar first
+ */
+std::vector<std::pair<std::filesystem::path, double>> DetectionService::score(const std::string& name, const TransitionVector& submission) const {
+    std::shared_ptr<const Assignment> assignment = find(name);
+    SimilarityService similarity;
+
+    std::vector<std::pair<std::filesystem::path, double>> result;
+    for (size_t i = 0; i < assignment->files.size(); i++) {
+        result.push_back(std::make_pair(assignment->files[i], similarity.getSimilarity(submission, assignment->matrices[i])));
+    }
+    std::stable_sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second;
+    });
+    return result;
+}
+
+#endif // DETECTIONSERVICE_H
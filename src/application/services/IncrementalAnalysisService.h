@@ -0,0 +1,226 @@
+#ifndef INCREMENTALANALYSISSERVICE_H
+#define INCREMENTALANALYSISSERVICE_H
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../../domain/entities/TokenDictionary.h"
+#include "../../domain/entities/TransitionCounts.h"
+#include "../../domain/entities/TransitionVector.h"
+#include "../../domain/services/CFGCache.h"
+#include "../../domain/services/CFGStreamParser.h"
+#include "../../domain/services/HashService.h"
+#include "../../domain/services/LabelNormalizer.h"
+#include "../../domain/services/Metrics.h"
+
+
+/**
+ * @class IncrementalAnalysisService
+ * @brief Transition matrices of files that are analyzed again and again (resubmissions), at
+ *        method granularity. Every method's sub-CFG and transition counts are cached by the
+ *        hash of its source, and the extractor is told to skip the methods of a file's previous
+ *        version. The file's counts are then updated by subtracting the methods that went away
+ *        and adding the new ones, and only the final row normalization runs over the whole file.
+ *        The result is the same matrix SimilarityService::getTransitions builds from the full CFG.
+ *        Both the method and the file caches are bounded and emptied when full, so a resident
+ *        process does not grow with every new path; a file evicted from the cache is simply
+ *        re-extracted in full the next time it is analyzed.
+ */
+class IncrementalAnalysisService {
+    public:
+        typedef std::function<std::vector<CFGStreamParser::Method>(std::filesystem::path&, const std::vector<std::string>&)> MethodExtractor;
+
+    private:
+        struct Method {
+            CFGStreamParser::Method cfg;
+            TransitionCounts counts;
+        };
+
+        struct File {
+            std::string digest;
+            std::vector<std::string> methods;
+            TransitionCounts counts;
+            TransitionVector matrix;
+        };
+
+        const static size_t MAX_METHODS;
+        const static size_t MAX_FILES;
+        const static std::string ROOT;
+
+        std::mutex lock;
+        std::unordered_map<std::string, std::shared_ptr<const Method>> methods;
+        std::unordered_map<std::string, std::shared_ptr<const File>> files;
+        size_t capacity;
+        size_t fileCapacity;
+
+        static std::shared_ptr<const Method> count(CFGStreamParser::Method&);
+
+    public:
+        IncrementalAnalysisService(size_t = MAX_METHODS, size_t = MAX_FILES);
+        ~IncrementalAnalysisService();
+        TransitionVector getTransitions(std::filesystem::path&, const MethodExtractor&);
+        size_t getMethodCount();
+};
+
+
+/**
+ * @brief Constructor for the IncrementalAnalysisService class.
+ * @param capacity Methods kept before the method cache is emptied
+ * @param fileCapacity Files kept before the file cache is emptied
+ */
+IncrementalAnalysisService::IncrementalAnalysisService(size_t capacity, size_t fileCapacity) : capacity(capacity), fileCapacity(fileCapacity) {}
+
+
+/**
+ * @brief Destructor for the IncrementalAnalysisService class.
+ */
+IncrementalAnalysisService::~IncrementalAnalysisService(){}
+
+
+/**
+ * @brief Transition counts of a freshly extracted method, including the ROOT -> entry transition
+ *        that joins it to the file's CFG. Labels are normalized and interned like CSRGraph does.
+ * @param cfg Sub-CFG of the method
+ * @return Cached form of the method
+ */
+std::shared_ptr<const IncrementalAnalysisService::Method> IncrementalAnalysisService::count(CFGStreamParser::Method& cfg) {
+    const LabelNormalizer& normalizer = LabelNormalizer::java();
+    TokenDictionary& dictionary = TokenDictionary::global();
+
+    std::vector<uint32_t> labels;
+    labels.reserve(cfg.labels.size());
+    for (const std::string& label : cfg.labels) {
+        labels.push_back(dictionary.intern(normalizer.normalize(label)));
+    }
+
+    std::vector<uint64_t> transitions;
+    transitions.reserve(cfg.edges.size() + 1);
+    for (const auto& edge : cfg.edges) {
+        transitions.push_back(TransitionCounts::key(labels[edge.first], labels[edge.second]));
+    }
+    if (cfg.entry >= 0) {
+        transitions.push_back(TransitionCounts::key(dictionary.intern(normalizer.normalize(ROOT)), labels[cfg.entry]));
+    }
+
+    auto method = std::make_shared<Method>();
+    method->cfg = std::move(cfg);
+    method->counts = TransitionCounts(std::move(transitions));
+    return method;
+}
+
+
+/**
+ * @brief Transition matrix of a file, re-extracting only the methods that changed since the
+ *        last time this path was analyzed. An unchanged file is not extracted at all.
+ * @param sourceCode File to analyze
+ * @param extract Method-level extractor, e.g. CFGBuilderController::getMethods
+ * @throws std::runtime_error if the file cannot be read or extracted.
+ * @return Sparse transition matrix of the whole file
+ */
+TransitionVector IncrementalAnalysisService::getTransitions(std::filesystem::path& sourceCode, const MethodExtractor& extract) {
+    std::string path = std::filesystem::absolute(sourceCode).string();
+    std::string digest = HashService::digest(CFGCache::readFile(sourceCode));
+
+    // Previous version of the file and the methods it had that are still cached
+    std::shared_ptr<const File> previous;
+    std::unordered_map<std::string, std::shared_ptr<const Method>> known;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto file = files.find(path);
+        if (file != files.end()) {
+            previous = file->second;
+            if (previous->digest == digest) {
+                Metrics::add(Metrics::METHODS_REUSED, previous->methods.size());
+                return previous->matrix;
+            }
+            for (const std::string& hash : previous->methods) {
+                auto method = methods.find(hash);
+                if (method != methods.end()) known[hash] = method->second;
+            }
+        }
+    }
+
+    std::vector<std::string> knownHashes;
+    for (const auto& method : known) {
+        knownHashes.push_back(method.first);
+    }
+    std::vector<CFGStreamParser::Method> extracted = extract(sourceCode, knownHashes);
+
+    auto current = std::make_shared<File>();
+    current->digest = digest;
+    std::vector<std::shared_ptr<const Method>> added;
+    for (CFGStreamParser::Method& cfg : extracted) {
+        current->methods.push_back(cfg.hash);
+        if (cfg.cached) {
+            if (!known.count(cfg.hash)) {
+                throw std::runtime_error("extractor skipped an unknown method " + cfg.name);
+            }
+            Metrics::add(Metrics::METHODS_REUSED);
+            continue;
+        }
+        std::shared_ptr<const Method> method = count(cfg);
+        known[method->cfg.hash] = method;
+        added.push_back(method);
+        Metrics::add(Metrics::METHODS_BUILT);
+    }
+
+    {
+        Metrics::Timer timer(Metrics::TRANSITIONS);
+        std::vector<std::string> before = previous ? previous->methods : std::vector<std::string>();
+        std::vector<std::string> after = current->methods;
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+        std::vector<std::string> removed, inserted;
+        std::set_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(removed));
+        std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(inserted));
+
+        // Start from the previous counts only when every removed method is still at hand
+        bool incremental = previous && std::all_of(removed.begin(), removed.end(), [&known](const std::string& hash) {
+            return known.count(hash) > 0;
+        });
+        if (incremental) {
+            current->counts = previous->counts;
+            for (const std::string& hash : removed) current->counts.subtract(known[hash]->counts);
+            for (const std::string& hash : inserted) current->counts.add(known[hash]->counts);
+        } else {
+            for (const std::string& hash : current->methods) current->counts.add(known[hash]->counts);
+        }
+        current->matrix = TransitionVector(current->counts);
+    }
+    Metrics::add(Metrics::NONZEROS, current->matrix.nonZeros());
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (methods.size() + added.size() > capacity) {
+        methods.clear();
+    }
+    for (const std::shared_ptr<const Method>& method : added) {
+        methods[method->cfg.hash] = method;
+    }
+    if (files.size() >= fileCapacity && !files.count(path)) {
+        files.clear();
+    }
+    files[path] = current;
+    return current->matrix;
+}
+
+
+/**
+ * @brief Number of cached methods.
+ */
+size_t IncrementalAnalysisService::getMethodCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return methods.size();
+}
+
+const size_t IncrementalAnalysisService::MAX_METHODS = 1 << 16;
+const size_t IncrementalAnalysisService::MAX_FILES = 1 << 12;
+const std::string IncrementalAnalysisService::ROOT = "ROOT";
+
+#endif // INCREMENTALANALYSISSERVICE_H
@@ -0,0 +1,124 @@
+#ifndef METHODINDEXSERVICE_H
+#define METHODINDEXSERVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../domain/entities/MethodMatch.h"
+#include "../../domain/services/CFGStreamParser.h"
+#include "../../domain/services/MethodIndex.h"
+
+
+/**
+ * @class MethodIndexService
+ * @brief Finds copied methods inside otherwise original files. Every method of a corpus is
+ *        fingerprinted once into a MethodIndex, and each method of a query file is looked up
+ *        in it instead of comparing whole files pairwise.
+ */
+class MethodIndexService {
+    private:
+        struct Indexed {
+            size_t file;
+            std::string method;
+        };
+
+        MethodIndex index;
+        std::vector<std::filesystem::path> files;
+        std::vector<Indexed> methods;
+
+    public:
+        MethodIndexService(size_t = 2, size_t = 4);
+        ~MethodIndexService();
+        size_t add(std::vector<std::filesystem::path>&, const std::function<std::vector<CFGStreamParser::Method>(std::filesystem::path&, const std::vector<std::string>&)>&, size_t = 0);
+        std::vector<MethodMatch> query(std::filesystem::path&, const std::function<std::vector<CFGStreamParser::Method>(std::filesystem::path&, const std::vector<std::string>&)>&, double);
+};
+
+
+/**
+ * @brief Constructor for the MethodIndexService class.
+ * @param length Edges per transition shingle
+ * @param minimumShingles Methods with fewer shingles are ignored
+ */
+MethodIndexService::MethodIndexService(size_t length, size_t minimumShingles) : index(length, minimumShingles) {}
+
+
+/**
+ * @brief Destructor for the MethodIndexService class.
+ */
+MethodIndexService::~MethodIndexService(){}
+
+
+/**
+ * @brief Extract and index every method of a set of files. Extraction runs in parallel.
+ * @param corpus Files to index
+ * @param getMethods Method-level extractor, e.g. CFGBuilderController::getMethods
+ * @param threads Number of threads, 0 for one per core
+ * @return Number of methods indexed (files that fail to extract are skipped)
+ */
+size_t MethodIndexService::add(std::vector<std::filesystem::path>& corpus, const std::function<std::vector<CFGStreamParser::Method>(std::filesystem::path&, const std::vector<std::string>&)>& getMethods, size_t threads) {
+    std::vector<std::vector<std::pair<std::string, std::vector<uint64_t>>>> fingerprints(corpus.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t t = 0; t < std::min(threads, corpus.size()); t++) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < corpus.size(); i = next++) {
+                try {
+                    for (const CFGStreamParser::Method& method : getMethods(corpus[i], {})) {
+                        fingerprints[i].push_back(std::make_pair(method.name, index.shingles(method)));
+                    }
+                } catch (const std::exception& e) {
+                    fingerprints[i].clear();
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    size_t added = 0;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        size_t file = files.size();
+        files.push_back(corpus[i]);
+        for (const auto& fingerprint : fingerprints[i]) {
+            if (index.add(fingerprint.second) == (size_t) -1) continue;
+            methods.push_back(Indexed{file, fingerprint.first});
+            added++;
+        }
+    }
+    return added;
+}
+
+
+/**
+ * @brief Corpus methods that resemble the methods of a file. Methods of the same file are skipped.
+ * @param file Query file
+ * @param getMethods Method-level extractor, e.g. CFGBuilderController::getMethods
+ * @param threshold Minimum Jaccard similarity of the transition shingles
+ * @throws std::runtime_error if the query file cannot be extracted.
+ * @return Matching method pairs, most similar first
+ */
+std::vector<MethodMatch> MethodIndexService::query(std::filesystem::path& file, const std::function<std::vector<CFGStreamParser::Method>(std::filesystem::path&, const std::vector<std::string>&)>& getMethods, double threshold) {
+    std::filesystem::path self = std::filesystem::weakly_canonical(file);
+    std::vector<MethodMatch> result;
+
+    for (const CFGStreamParser::Method& method : getMethods(file, {})) {
+        for (const auto& match : index.query(index.shingles(method), threshold)) {
+            const Indexed& indexed = methods[match.first];
+            if (std::filesystem::weakly_canonical(files[indexed.file]) == self) continue;
+            result.push_back(MethodMatch{method.name, files[indexed.file], indexed.method, match.second});
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const MethodMatch& a, const MethodMatch& b) {
+        return a.score > b.score;
+    });
+    return result;
+}
+
+#endif // METHODINDEXSERVICE_H
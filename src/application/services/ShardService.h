@@ -0,0 +1,392 @@
+#ifndef SHARDSERVICE_H
+#define SHARDSERVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+#include "../../domain/entities/UGraph.h"
+#include "../../domain/entities/TransitionVector.h"
+#include "../../domain/entities/SimilarityPair.h"
+#include "../../domain/entities/ShardReport.h"
+#include "../../domain/services/CFGWorkerPool.h"
+#include "../../domain/services/GraphArena.h"
+#include "../../domain/services/Metrics.h"
+#include "CorpusService.h"
+#include "SimilarityService.h"
+
+
+/**
+ * @class ShardService
+ * @brief All-pairs scoring split across worker processes. The coordinator cuts the upper
+ *        triangle of the pair matrix into tiles and hands each one to a worker process over
+ *        pipes (CFGWorkerPool framing); a worker loads the graphs of the tile's files only,
+ *        scores the tile with SimilarityService and sends back the pairs above the threshold.
+ *        Failed tiles are retried, on whichever worker is free (a dead one is restarted).
+ *
+ *        Tile request, in host byte order: threshold (double), diagonal flag, row count and
+ *        column count (uint32 each), then every path as a uint32 length and its bytes, rows
+ *        first; a diagonal tile compares its rows with themselves and lists no columns.
+ *        Response: pairs scored (uint64), pair count (uint32), then (uint32 row, uint32 column,
+ *        double score) per pair, with row and column indexes into the tile.
+ */
+class ShardService {
+    private:
+        struct Tile {
+            size_t rowStart;
+            size_t rowEnd;
+            size_t colStart;
+            size_t colEnd;
+        };
+
+        const static size_t MATRIX_CACHE;
+
+        template<class T>
+        static void put(std::string&, T);
+        template<class T>
+        static T take(const char*&, const char*);
+        static std::string encode(const std::vector<std::filesystem::path>&, const Tile&, double);
+        static uint64_t decode(const std::string&, const Tile&, std::vector<SimilarityPair>&);
+        static bool readAll(int, char*, size_t);
+        static void writeAll(int, const char*, size_t);
+
+    public:
+        ShardService();
+        ~ShardService();
+        std::vector<SimilarityPair> coordinate(const std::vector<std::filesystem::path>&, double, CFGWorkerPool&, size_t, size_t, ShardReport&);
+        std::string scoreTile(const char*, size_t, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&, std::unordered_map<std::string, TransitionVector>&);
+        void serve(int, int, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>&);
+};
+
+
+/**
+ * @brief Constructor for the ShardService class.
+ */
+ShardService::ShardService(){}
+
+
+/**
+ * @brief Destructor for the ShardService class.
+ */
+ShardService::~ShardService(){}
+
+
+/**
+ * @brief Append a value to a message.
+ */
+template<class T>
+void ShardService::put(std::string& message, T value) {
+    message.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+/**
+ * @brief Read a value from a message.
+ * @throws std::runtime_error if the message ends first.
+ */
+template<class T>
+T ShardService::take(const char*& data, const char* end) {
+    if ((size_t) (end - data) < sizeof(T)) {
+        throw std::runtime_error("ShardService: truncated message");
+    }
+    T value;
+    memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return value;
+}
+
+
+/**
+ * @brief Request of a tile.
+ */
+std::string ShardService::encode(const std::vector<std::filesystem::path>& files, const Tile& tile, double threshold) {
+    bool diagonal = tile.rowStart == tile.colStart;
+    std::string request;
+    put<double>(request, threshold);
+    put<uint32_t>(request, diagonal);
+    put<uint32_t>(request, tile.rowEnd - tile.rowStart);
+    put<uint32_t>(request, diagonal ? 0 : tile.colEnd - tile.colStart);
+
+    auto path = [&request](const std::filesystem::path& file) {
+        std::string name = file.string();
+        put<uint32_t>(request, name.size());
+        request.append(name);
+    };
+    for (size_t i = tile.rowStart; i < tile.rowEnd; i++) path(files[i]);
+    if (!diagonal) {
+        for (size_t j = tile.colStart; j < tile.colEnd; j++) path(files[j]);
+    }
+    return request;
+}
+
+
+/**
+ * @brief Check a tile's response and turn its pairs into corpus indexes.
+ * @param response Response payload
+ * @param tile Tile the response answers
+ * @param pairs Receives the pairs
+ * @throws std::runtime_error if the response is malformed.
+ * @return Pairs the worker scored
+ */
+uint64_t ShardService::decode(const std::string& response, const Tile& tile, std::vector<SimilarityPair>& pairs) {
+    const char* data = response.data();
+    const char* end = data + response.size();
+    uint64_t scored = take<uint64_t>(data, end);
+    uint32_t count = take<uint32_t>(data, end);
+    if ((size_t) (end - data) != count * (2 * sizeof(uint32_t) + sizeof(double))) {
+        throw std::runtime_error("ShardService: malformed response");
+    }
+
+    for (uint32_t k = 0; k < count; k++) {
+        uint32_t row = take<uint32_t>(data, end);
+        uint32_t column = take<uint32_t>(data, end);
+        double score = take<double>(data, end);
+        if (row >= tile.rowEnd - tile.rowStart || column >= tile.colEnd - tile.colStart) {
+            throw std::runtime_error("ShardService: pair outside its tile");
+        }
+        pairs.push_back(SimilarityPair{tile.rowStart + row, tile.colStart + column, score});
+    }
+    return scored;
+}
+
+
+/**
+ * @brief Score the upper triangle of the pair matrix on worker processes.
+ * @param files Corpus files, as the workers see them
+ * @param threshold Minimum score reported
+ * @param workers Pool of shard workers (processes running serve)
+ * @param tileSize Files per tile side
+ * @param retries Attempts after the first before a tile is given up
+ * @param report Filled with the totals of the run
+ * @return Pairs (indexes into files) scoring at least threshold, most similar first; the pairs
+ *         of tiles given up are missing
+ */
+std::vector<SimilarityPair> ShardService::coordinate(const std::vector<std::filesystem::path>& files, double threshold, CFGWorkerPool& workers, size_t tileSize, size_t retries, ShardReport& report) {
+    uint64_t start = Metrics::now();
+    size_t blocks = (files.size() + tileSize - 1) / tileSize;
+    std::vector<Tile> tiles;
+    for (size_t bi = 0; bi < blocks; bi++) {
+        for (size_t bj = bi; bj < blocks; bj++) {
+            tiles.push_back(Tile{bi * tileSize, std::min(files.size(), (bi + 1) * tileSize), bj * tileSize, std::min(files.size(), (bj + 1) * tileSize)});
+        }
+    }
+
+    report = ShardReport();
+    report.tiles = tiles.size();
+    std::vector<SimilarityPair> result;
+    std::mutex merge;
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+
+    // One thread per worker keeps every worker busy; the pool sends each request to an idle one
+    for (size_t t = 0; t < std::min(workers.size(), tiles.size()); t++) {
+        threads.emplace_back([&]() {
+            for (size_t k = next++; k < tiles.size(); k = next++) {
+                std::string request = encode(files, tiles[k], threshold);
+                std::vector<SimilarityPair> local;
+                uint64_t scored = 0;
+                size_t retried = 0;
+                bool done = false;
+
+                for (size_t attempt = 0; attempt <= retries && !done; attempt++) {
+                    std::string response;
+                    local.clear();
+                    try {
+                        workers.request(request, [&response](const char* data, size_t size) {
+                            response.append(data, size);
+                        });
+                        scored = decode(response, tiles[k], local);
+                        done = true;
+                    } catch (const std::exception& e) {
+                        std::cout << "ShardService: tile " << k << " failed: " << e.what() << std::endl;
+                    }
+                    if (!done && attempt < retries) {
+                        retried++;
+                        Metrics::add(Metrics::TILES_RETRIED);
+                    }
+                }
+
+                std::lock_guard<std::mutex> guard(merge);
+                report.retries += retried;
+                if (done) {
+                    result.insert(result.end(), local.begin(), local.end());
+                    report.pairs += scored;
+                } else {
+                    report.failed++;
+                    Metrics::add(Metrics::TILES_FAILED);
+                }
+                Metrics::add(Metrics::TILES);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    CorpusService::sortPairs(result);
+    Metrics::add(Metrics::PAIRS, report.pairs);
+    report.seconds = (Metrics::now() - start) / 1e9;
+    return result;
+}
+
+
+/**
+ * @brief Score one tile. Matrices stay cached by path across tiles, up to MATRIX_CACHE files.
+ * @param data Tile request
+ * @param size Request size
+ * @param getGraph CFG builder into the given arena, e.g. CFGBuilderController::getGraph
+ * @param matrices Matrices of the files already loaded by this worker
+ * @throws std::runtime_error if the request is malformed.
+ * @return Tile response
+ */
+std::string ShardService::scoreTile(const char* data, size_t size, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph, std::unordered_map<std::string, TransitionVector>& matrices) {
+    const char* end = data + size;
+    double threshold = take<double>(data, end);
+    bool diagonal = take<uint32_t>(data, end);
+    uint32_t rows = take<uint32_t>(data, end);
+    uint32_t columns = take<uint32_t>(data, end);
+
+    std::vector<std::string> paths;
+    for (size_t k = 0; k < (size_t) rows + columns; k++) {
+        uint32_t length = take<uint32_t>(data, end);
+        if ((size_t) (end - data) < length) {
+            throw std::runtime_error("ShardService: truncated message");
+        }
+        paths.emplace_back(data, length);
+        data += length;
+    }
+    if (data != end) {
+        throw std::runtime_error("ShardService: malformed request");
+    }
+
+    // Only the files of this tile are loaded; failed builds score like an empty matrix
+    if (matrices.size() + paths.size() > MATRIX_CACHE) {
+        matrices.clear();
+    }
+    SimilarityService similarity;
+    GraphArena arena;
+    std::vector<const TransitionVector*> loaded;
+    for (const std::string& path : paths) {
+        auto it = matrices.find(path);
+        if (it == matrices.end()) {
+            std::filesystem::path file = path;
+            UGraph<std::string>* graph = getGraph(file, &arena);
+            it = matrices.emplace(path, graph ? similarity.getTransitions(*graph) : TransitionVector()).first;
+            arena.release();
+        }
+        loaded.push_back(&it->second);
+    }
+
+    const TransitionVector* const* first = loaded.data();
+    const TransitionVector* const* second = diagonal ? first : first + rows;
+    uint32_t secondCount = diagonal ? rows : columns;
+    uint64_t scored = 0;
+    std::string pairs;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        for (uint32_t j = diagonal ? i + 1 : 0; j < secondCount; j++) {
+            double score = similarity.similarityAtLeast(*first[i], *second[j], threshold);
+            scored++;
+            if (score >= threshold) {
+                put<uint32_t>(pairs, i);
+                put<uint32_t>(pairs, j);
+                put<double>(pairs, score);
+                count++;
+            }
+        }
+    }
+
+    std::string response;
+    put<uint64_t>(response, scored);
+    put<uint32_t>(response, count);
+    return response + pairs;
+}
+
+
+/**
+ * @brief Write a whole buffer to a pipe.
+ * @throws std::runtime_error if the coordinator closed its end.
+ */
+void ShardService::writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t bytes = write(fd, data, size);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("ShardService: cannot write to coordinator");
+        }
+        data += bytes;
+        size -= bytes;
+    }
+}
+
+
+/**
+ * @brief Read exactly `size` bytes from a pipe.
+ * @return False if the coordinator closed its end first
+ */
+bool ShardService::readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t bytes = read(fd, data, size);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) return false;
+        data += bytes;
+        size -= bytes;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Worker loop: answer tile requests until the coordinator closes the input.
+ *        Requests are framed as a 4-byte big-endian length + payload; responses as a
+ *        status byte (0 ok, 1 error message) + 4-byte big-endian length + payload.
+ * @param input Pipe the requests arrive on
+ * @param output Pipe the responses go to; nothing else may write to it
+ * @param getGraph CFG builder into the given arena, e.g. CFGBuilderController::getGraph
+ * @throws std::runtime_error if the coordinator stops reading.
+ */
+void ShardService::serve(int input, int output, const std::function<UGraph<std::string>*(std::filesystem::path&, GraphArena*)>& getGraph) {
+    std::unordered_map<std::string, TransitionVector> matrices;
+    unsigned char header[5];
+
+    while (readAll(input, reinterpret_cast<char*>(header), 4)) {
+        uint32_t size = 0;
+        for (int i = 0; i < 4; i++) {
+            size = (size << 8) | header[i];
+        }
+        std::string request(size, '\0');
+        if (!readAll(input, &request[0], size)) {
+            return;
+        }
+
+        std::string response;
+        header[0] = 0;
+        try {
+            response = scoreTile(request.data(), request.size(), getGraph, matrices);
+        } catch (const std::exception& e) {
+            header[0] = 1;
+            response = e.what();
+        }
+
+        for (int i = 0; i < 4; i++) {
+            header[1 + i] = (response.size() >> (24 - 8 * i)) & 0xFF;
+        }
+        writeAll(output, reinterpret_cast<const char*>(header), 5);
+        writeAll(output, response.data(), response.size());
+    }
+}
+
+const size_t ShardService::MATRIX_CACHE = 4096;
+
+#endif // SHARDSERVICE_H
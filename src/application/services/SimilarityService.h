@@ -8,7 +8,13 @@
 #include <string>
 #include <cmath>
 #include <set>
+#include <unordered_map>
 #include "../../domain/entities/UGraph.h"
+#include "../../domain/entities/CSRGraph.h"
+#include "../../domain/entities/TransitionVector.h"
+#include "../../domain/services/CosineKernel.h"
+#include "../../domain/services/LabelNormalizer.h"
+#include "../../domain/services/Metrics.h"
 
 
 /**
@@ -17,13 +23,27 @@
  */
 class SimilarityService {
     private:
-        std::vector<std::string> getBagOfTokens(UGraph<std::string>*, UGraph<std::string>*);
-        void fillMatrix(std::vector<std::string>&, std::vector<std::vector<double>>&, UGraph<std::string>*);
+        std::vector<uint32_t> getBagOfTokens(const CSRGraph&, const CSRGraph&);
+        template<class Real>
+        void fillMatrix(std::unordered_map<uint32_t, size_t>&, std::vector<Real>&, size_t, const CSRGraph&);
+        template<class Real>
+        double denseSimilarity(const CSRGraph&, const CSRGraph&);
 
     public:
+        const static std::string SCORING_VERSION;
+
         SimilarityService();
         ~SimilarityService();
+        CSRGraph freeze(const UGraph<std::string>&);
+        TransitionVector getTransitions(const UGraph<std::string>&);
+        TransitionVector getTransitions(const CSRGraph&);
         double getSimilarity(UGraph<std::string>*, UGraph<std::string>*);
+        double getSimilarity(const CSRGraph&, const CSRGraph&);
+        double getSimilarity(const TransitionVector&, const TransitionVector&);
+        double similarityAtLeast(UGraph<std::string>*, UGraph<std::string>*, double);
+        double similarityAtLeast(const CSRGraph&, const CSRGraph&, double);
+        double similarityAtLeast(const TransitionVector&, const TransitionVector&, double);
+        double getDenseSimilarity(const CSRGraph&, const CSRGraph&, bool = false);
 };
 
 
@@ -43,62 +63,89 @@ SimilarityService::~SimilarityService(){}
  * @brief  Get the bag of tokens from two graphs.
  * @param cfg1 1st graph
  * @param cfg2 2nd graph
- * @return Unique tokens between the two graphs
+ * @return Unique token ids between the two graphs
  */
-std::vector<std::string> SimilarityService::getBagOfTokens(UGraph<std::string>* cfg1, UGraph<std::string>* cfg2) {
-    std::set<std::string> bagOfTokens;
-    
-    for(std::pair<int, std::string> p : cfg1->getVertexes()) {
-        bagOfTokens.insert(p.second);
-    }
+std::vector<uint32_t> SimilarityService::getBagOfTokens(const CSRGraph& cfg1, const CSRGraph& cfg2) {
+    std::vector<uint32_t> tokens1 = cfg1.getTokens();
+    std::vector<uint32_t> tokens2 = cfg2.getTokens();
+    std::vector<uint32_t> bagOfTokens;
 
-    for(std::pair<int, std::string> p : cfg2->getVertexes()) {
-        bagOfTokens.insert(p.second);
-    }
-
-    std::vector<std::string> result(bagOfTokens.begin(), bagOfTokens.end());
-    return result;
+    std::set_union(tokens1.begin(), tokens1.end(), tokens2.begin(), tokens2.end(), std::back_inserter(bagOfTokens));
+    return bagOfTokens;
 }
 
 
 /**
- * @brief Set the probability of each node to be the movement of the previous
- * @param bagOfTokens Unique tokes on the graph
- * @param matrix Empty matrix to fill
+ * @brief Set the probability of each node to be the movement of the previous.
+ *        Transitions of every vertex sharing a label are counted in one pass over the edges.
+ * @param positions Row/column of each token of the bag
+ * @param matrix Zeroed size x size matrix to fill, row-major
+ * @param size Number of tokens of the bag
  * @param cfg Graph that contains each node's movement
  * @return Matrix with movement's probabilities
  */
-void SimilarityService::fillMatrix(std::vector<std::string>& bagOfTokens, std::vector<std::vector<double>>& matrix, UGraph<std::string>* graph) {
-    std::vector<std::pair<int, std::string>> vertexes = graph->getVertexes();
-    std::vector<std::pair<int, std::string>>::iterator it;
-
-    for (int i = 0; i < bagOfTokens.size(); i++) {
-        std::string keyToken = bagOfTokens[i];
-        
-        // Verificamos que el token exista en el grafo, sino continuamos
-        it = std::find_if(vertexes.begin(), vertexes.end(), [keyToken](const std::pair<int, std::string>& p) {
-            return p.second == keyToken;
-        });
-        if (it == vertexes.end()) continue;
-        
-        for (int j = 0; j < bagOfTokens.size(); j++) {
-            std::vector<std::pair<int, std::string>> connections = graph->getConnectionsFrom(bagOfTokens[i]);
-            int total = 0;
-            for(auto p : connections){
-                total += p.first;
-            }
-            std::string valueToken = bagOfTokens[j];
-            it = std::find_if(connections.begin(), connections.end(), [valueToken](const std::pair<int, std::string>& p) {
-                return p.second == valueToken;
-            });
-            if (it == connections.end()){
-                continue;
-            }
-            
-            matrix[i][j] = (double)it->first / total;
-           
+template<class Real>
+void SimilarityService::fillMatrix(std::unordered_map<uint32_t, size_t>& positions, std::vector<Real>& matrix, size_t size, const CSRGraph& graph) {
+    std::vector<double> totals(size, 0.0);
+
+    for (uint32_t v = 0; v < graph.vertexCount(); v++) {
+        size_t i = positions[graph.label(v)];
+        for (const uint32_t* it = graph.successorsBegin(v); it != graph.successorsEnd(v); it++) {
+            matrix[i * size + positions[graph.label(*it)]] += 1;
+            totals[i] += 1.0;
         }
     }
+
+    for (size_t i = 0; i < size; i++) {
+        if (!totals[i]) continue;
+        for (size_t j = i * size; j < (i + 1) * size; j++) {
+            matrix[j] = (Real) (matrix[j] / totals[i]);
+        }
+    }
+}
+
+
+/**
+ * @brief Freeze a graph with normalized labels (LabelNormalizer), so files that only
+ *        differ in names, types or constants share their tokens.
+ * @param cfg Graph to freeze
+ * @return Frozen graph over the global TokenDictionary
+ */
+CSRGraph SimilarityService::freeze(const UGraph<std::string>& cfg) {
+    Metrics::Timer timer(Metrics::FREEZE);
+    const LabelNormalizer& normalizer = LabelNormalizer::java();
+    return CSRGraph(cfg, TokenDictionary::global(), [&normalizer](std::string_view label) {
+        return normalizer.normalize(label);
+    });
+}
+
+
+/**
+ * @brief Freeze a graph (see freeze) and build its transition matrix.
+ * @param cfg Graph to prepare
+ * @return Sparse transition matrix
+ */
+TransitionVector SimilarityService::getTransitions(const UGraph<std::string>& cfg) {
+    return getTransitions(freeze(cfg));
+}
+
+
+/**
+ * @brief Build the transition matrix of a frozen graph.
+ * @param cfg Graph to prepare
+ * @return Sparse transition matrix
+ */
+TransitionVector SimilarityService::getTransitions(const CSRGraph& cfg) {
+    TransitionVector matrix;
+    {
+        Metrics::Timer timer(Metrics::TRANSITIONS);
+        matrix = TransitionVector(cfg);
+    }
+    Metrics::add(Metrics::VERTICES, cfg.vertexCount());
+    Metrics::add(Metrics::EDGES, cfg.edgeCount());
+    Metrics::add(Metrics::VOCABULARY, cfg.getTokens().size());
+    Metrics::add(Metrics::NONZEROS, matrix.nonZeros());
+    return matrix;
 }
 
 
@@ -109,37 +156,116 @@ void SimilarityService::fillMatrix(std::vector<std::string>& bagOfTokens, std::v
  * @return Similarity between 0 and 1
  */
 double SimilarityService::getSimilarity(UGraph<std::string>* cfg1, UGraph<std::string>* cfg2) {
-    std::vector<std::string> bagOfTokens = getBagOfTokens(cfg1, cfg2);
-
-    std::vector<std::vector<double>> matrix1(bagOfTokens.size(), std::vector<double>(bagOfTokens.size()));
-    std::vector<std::vector<double>> matrix2(bagOfTokens.size(), std::vector<double>(bagOfTokens.size()));
-    
-    fillMatrix(bagOfTokens, matrix1, cfg1);
-    fillMatrix(bagOfTokens, matrix2, cfg2);
-
-    std::vector<double> flattened1, flattened2;
-    for (int i = 0; i < bagOfTokens.size(); i++) {
-        flattened1.insert(flattened1.end(), matrix1[i].begin(), matrix1[i].end());
-        flattened2.insert(flattened2.end(), matrix2[i].begin(), matrix2[i].end());
+    return getSimilarity(getTransitions(*cfg1), getTransitions(*cfg2));
+}
+
+
+/**
+ * @brief Use Markov to determine similarity between frozen graphs
+ * @param cfg1 Base cfg
+ * @param cfg2 Cfg to compare
+ * @return Similarity between 0 and 1
+ */
+double SimilarityService::getSimilarity(const CSRGraph& cfg1, const CSRGraph& cfg2) {
+    return getSimilarity(getTransitions(cfg1), getTransitions(cfg2));
+}
+
+
+/**
+ * @brief Cosine between two sparse transition matrices, in O(nnz)
+ * @param matrix1 Base cfg's transitions
+ * @param matrix2 Transitions to compare
+ * @return Similarity between 0 and 1
+ */
+double SimilarityService::getSimilarity(const TransitionVector& matrix1, const TransitionVector& matrix2) {
+    Metrics::Timer timer(Metrics::SIMILARITY);
+    Metrics::add(Metrics::PAIRS);
+    return matrix1.cosine(matrix2);
+}
+
+
+/**
+ * @brief Similarity for a decision against a cutoff: pairs that cannot reach it are rejected
+ *        early, from the norms of the rows of the labels both graphs share.
+ * @param cfg1 Base cfg
+ * @param cfg2 Cfg to compare
+ * @param threshold Similarity the pair needs
+ * @return The exact similarity if it is at least threshold, otherwise a value below threshold
+ */
+double SimilarityService::similarityAtLeast(UGraph<std::string>* cfg1, UGraph<std::string>* cfg2, double threshold) {
+    return similarityAtLeast(getTransitions(*cfg1), getTransitions(*cfg2), threshold);
+}
+
+
+/**
+ * @brief Similarity of frozen graphs for a decision against a cutoff.
+ * @param cfg1 Base cfg
+ * @param cfg2 Cfg to compare
+ * @param threshold Similarity the pair needs
+ * @return The exact similarity if it is at least threshold, otherwise a value below threshold
+ */
+double SimilarityService::similarityAtLeast(const CSRGraph& cfg1, const CSRGraph& cfg2, double threshold) {
+    return similarityAtLeast(getTransitions(cfg1), getTransitions(cfg2), threshold);
+}
+
+
+/**
+ * @brief Similarity of two sparse transition matrices for a decision against a cutoff.
+ *        Pairs below the threshold are counted as rejected.
+ * @param matrix1 Base cfg's transitions
+ * @param matrix2 Transitions to compare
+ * @param threshold Similarity the pair needs
+ * @return The exact similarity if it is at least threshold, otherwise a value below threshold
+ */
+double SimilarityService::similarityAtLeast(const TransitionVector& matrix1, const TransitionVector& matrix2, double threshold) {
+    Metrics::Timer timer(Metrics::SIMILARITY);
+    Metrics::add(Metrics::PAIRS);
+    double score = matrix1.cosineAtLeast(matrix2, threshold);
+    if (score < threshold) {
+        Metrics::add(Metrics::PAIRS_REJECTED);
     }
+    return score;
+}
+
 
-    double magnitude1 = 0.0, magnitude2 = 0.0;
-    for(double elem : flattened1) {
-        magnitude1 += elem * elem;
+/**
+ * @brief Use Markov to determine similarity with dense T x T matrices over the bag of tokens.
+ *        Reference for the sparse path; memory grows quadratically with the vocabulary.
+ * @param cfg1 Base cfg
+ * @param cfg2 Cfg to compare
+ * @param singlePrecision Store the matrices as float (half the memory traffic, sums stay double)
+ * @return Similarity between 0 and 1
+ */
+double SimilarityService::getDenseSimilarity(const CSRGraph& cfg1, const CSRGraph& cfg2, bool singlePrecision) {
+    Metrics::Timer timer(Metrics::DENSE_SIMILARITY);
+    Metrics::add(Metrics::PAIRS);
+    if (singlePrecision) {
+        return denseSimilarity<float>(cfg1, cfg2);
     }
-    magnitude1 = sqrt(magnitude1);
+    return denseSimilarity<double>(cfg1, cfg2);
+}
 
-    for(double elem : flattened2) {
-        magnitude2 += elem * elem;
+
+/**
+ * @brief Fill both flattened matrices and take their cosine in one fused pass.
+ */
+template<class Real>
+double SimilarityService::denseSimilarity(const CSRGraph& cfg1, const CSRGraph& cfg2) {
+    std::vector<uint32_t> bagOfTokens = getBagOfTokens(cfg1, cfg2);
+    std::unordered_map<uint32_t, size_t> positions;
+    for (size_t i = 0; i < bagOfTokens.size(); i++) {
+        positions[bagOfTokens[i]] = i;
     }
-    magnitude2 = sqrt(magnitude2);
 
-    if (!magnitude1 || !magnitude2)
-        return 0.0;
+    size_t size = bagOfTokens.size();
+    std::vector<Real> matrix1(size * size), matrix2(size * size);
 
-    double producto_punto = std::inner_product(flattened1.begin(), flattened1.end(), flattened2.begin(), 0.0);
+    fillMatrix(positions, matrix1, size, cfg1);
+    fillMatrix(positions, matrix2, size, cfg2);
 
-    return producto_punto/(magnitude1*magnitude2);
+    return CosineKernel::cosine(matrix1.data(), matrix2.data(), matrix1.size());
 }
 
-#endif // SIMILARITYSERVICE_H
\ No newline at end of file
+const std::string SimilarityService::SCORING_VERSION = "markov-cosine:1"; // bump when scores change
+
+#endif // SIMILARITYSERVICE_H
@@ -0,0 +1,367 @@
+#include <bits/stdc++.h>
+
+#include "./application/controllers/CFGBuilderController.h"
+#include "./application/services/CFGBuilderService.h"
+#include "./application/services/CorpusService.h"
+#include "./application/services/SimilarityService.h"
+#include "./domain/entities/UGraph.h"
+#include "./domain/services/CosineKernel.h"
+#include "./domain/services/GraphArena.h"
+#include "./domain/services/GraphFingerprint.h"
+#include "./domain/services/GraphSerializer.h"
+#include "./domain/services/LabelNormalizer.h"
+
+using namespace std;
+
+struct Measurement {
+    string name;
+    double median, best, mean;
+    double items;
+};
+
+/**
+ * @brief Run a benchmark body several times and keep the per-run wall time.
+ * @param name Benchmark name
+ * @param repetitions Timed runs (after one warm-up run)
+ * @param items Work items per run, used for the throughput column
+ * @param body Code to time
+ */
+Measurement measure(const string& name, int repetitions, double items, const function<void()>& body) {
+    vector<double> times;
+    body();
+    for (int i = 0; i < repetitions; i++) {
+        auto start = chrono::steady_clock::now();
+        body();
+        times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    sort(times.begin(), times.end());
+    double mean = accumulate(times.begin(), times.end(), 0.0) / times.size();
+    return Measurement{name, times[times.size() / 2], times[0], mean, items};
+}
+
+void report(const Measurement& m) {
+    double throughput = m.median > 0 ? m.items / (m.median / 1000.0) : 0.0;
+    cout << left << setw(44) << m.name << right
+         << setw(12) << fixed << setprecision(3) << m.median
+         << setw(12) << m.best
+         << setw(12) << m.mean
+         << setw(16) << setprecision(0) << throughput << endl;
+}
+
+/**
+ * @brief Random CFG-like graph: `vertexes` nodes drawn from a `labels`-word vocabulary.
+ */
+UGraph<string>* syntheticGraph(mt19937& rng, int vertexes, int edgesPerVertex, int labels, GraphArena* arena = nullptr) {
+    UGraph<string>* graph = GraphArena::create(arena, true);
+    vector<pair<int, string>> nodes;
+    for (int i = 0; i < vertexes; i++) {
+        nodes.push_back(make_pair(i, "expression_statement_" + to_string(rng() % labels)));
+    }
+    for (int i = 0; i < vertexes; i++) {
+        if (i + 1 < vertexes) graph->addEdge(nodes[i], nodes[i + 1]);
+        for (int e = 1; e < edgesPerVertex; e++) {
+            graph->addEdge(nodes[i], nodes[rng() % vertexes]);
+        }
+    }
+    return graph;
+}
+
+/**
+ * @brief Check that every CosineKernel variant this CPU runs agrees with the scalar loop, and that
+ *        the dense paths (double and float storage) agree with the sparse similarity.
+ * @return Number of disagreements
+ */
+int checkKernels(unsigned seed) {
+    const CosineKernel::Variant variants[] = {CosineKernel::Variant::SCALAR, CosineKernel::Variant::SSE2, CosineKernel::Variant::AVX2, CosineKernel::Variant::AVX512};
+    mt19937 rng(seed);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    int failures = 0;
+
+    auto expect = [&failures](const string& what, double expected, double actual, double tolerance) {
+        bool ok = fabs(expected - actual) <= tolerance;
+        failures += ok ? 0 : 1;
+        cout << (ok ? "ok   " : "FAIL ") << left << setw(52) << what << right << setprecision(15)
+             << expected << " " << actual << endl;
+    };
+
+    cout << "Fastest cosine kernel: " << CosineKernel::name(CosineKernel::best()) << endl;
+    for (size_t size : {0, 1, 3, 7, 8, 9, 31, 1000, 4099}) {
+        vector<double> a(size), b(size);
+        for (size_t i = 0; i < size; i++) {
+            a[i] = uniform(rng) < 0.3 ? uniform(rng) : 0.0;
+            b[i] = uniform(rng) < 0.3 ? uniform(rng) : 0.0;
+        }
+        vector<float> af(a.begin(), a.end()), bf(b.begin(), b.end());
+        double reference = CosineKernel::cosine(a.data(), b.data(), size, CosineKernel::Variant::SCALAR);
+        double referenceFloat = CosineKernel::cosine(af.data(), bf.data(), size, CosineKernel::Variant::SCALAR);
+
+        for (CosineKernel::Variant variant : variants) {
+            if (!CosineKernel::supported(variant)) continue;
+            string name = string(CosineKernel::name(variant)) + " n=" + to_string(size);
+            expect(name + " double", reference, CosineKernel::cosine(a.data(), b.data(), size, variant), 1e-12);
+            expect(name + " float", referenceFloat, CosineKernel::cosine(af.data(), bf.data(), size, variant), 1e-12);
+        }
+        expect("float storage vs double n=" + to_string(size), reference, referenceFloat, 1e-6);
+    }
+
+    SimilarityService similarity;
+    for (int vertexes : {10, 200, 1500}) {
+        unique_ptr<UGraph<string>> first(syntheticGraph(rng, vertexes, 3, max(8, vertexes / 10)));
+        unique_ptr<UGraph<string>> second(syntheticGraph(rng, vertexes, 3, max(8, vertexes / 10)));
+        CSRGraph frozenFirst(*first), frozenSecond(*second);
+        double sparse = similarity.getSimilarity(frozenFirst, frozenSecond);
+        expect("dense double vs sparse, " + to_string(vertexes) + " vertexes", sparse, similarity.getDenseSimilarity(frozenFirst, frozenSecond), 1e-12);
+        expect("dense float vs sparse, " + to_string(vertexes) + " vertexes", sparse, similarity.getDenseSimilarity(frozenFirst, frozenSecond, true), 1e-6);
+
+        // Early exit: exact when the pair passes, below the cutoff otherwise
+        UGraph<string> near(*first);
+        vector<pair<int, string>> vertexList = first->getVertexes();
+        near.addEdge(vertexList.front(), vertexList.back());
+        CSRGraph frozenNear(near);
+        for (const CSRGraph* other : {&frozenSecond, &frozenNear}) {
+            double exact = similarity.getSimilarity(frozenFirst, *other);
+            for (double threshold : {0.0, 0.25, 0.75, 0.95, exact, nextafter(exact, 2.0)}) {
+                double atLeast = similarity.similarityAtLeast(frozenFirst, *other, threshold);
+                string name = "similarityAtLeast(" + to_string(threshold) + "), " + to_string(vertexes) + " vertexes";
+                if (exact >= threshold) {
+                    expect(name, exact, atLeast, 0.0);
+                } else {
+                    expect(name + " rejected", 1.0, atLeast < threshold ? 1.0 : 0.0, 0.0);
+                }
+            }
+        }
+
+        // Fingerprints ignore vertex ids, and files with equal ones are scored once
+        UGraph<string> renumbered;
+        for (const auto& vertex : first->getEdges()) {
+            for (const auto& successor : vertex.second) {
+                renumbered.addEdge(make_pair(vertexes - vertex.first.first, string(vertex.first.second)), make_pair(vertexes - successor.first, string(successor.second)));
+            }
+        }
+        CSRGraph frozenRenumbered(renumbered);
+        GraphFingerprint firstPrint(frozenFirst), renumberedPrint(frozenRenumbered), nearPrint(frozenNear), secondPrint(frozenSecond);
+        expect("equal fingerprint, renumbered copy, " + to_string(vertexes) + " vertexes", 1.0, firstPrint == renumberedPrint, 0.0);
+        expect("other fingerprint, edited copy, " + to_string(vertexes) + " vertexes", 1.0, firstPrint != nearPrint, 0.0);
+
+        vector<TransitionVector> corpus = {TransitionVector(frozenFirst), TransitionVector(frozenSecond), TransitionVector(frozenRenumbered), TransitionVector(frozenNear), TransitionVector(frozenFirst)};
+        vector<GraphFingerprint> prints = {firstPrint, secondPrint, renumberedPrint, nearPrint, firstPrint};
+        CorpusService corpusService;
+        vector<SimilarityPair> all = corpusService.compareAll(corpus, 0.5, 1);
+        vector<SimilarityPair> unique = corpusService.compareUnique(corpus, prints, 0.5, 0.0, 1);
+        bool same = all.size() == unique.size() && equal(all.begin(), all.end(), unique.begin(), [](const SimilarityPair& a, const SimilarityPair& b) {
+            return a.first == b.first && a.second == b.second && a.score == b.score;
+        });
+        expect("compareUnique vs compareAll, " + to_string(vertexes) + " vertexes", 1.0, same, 0.0);
+    }
+
+    cout << (failures ? "Kernel check failed" : "Kernel check passed") << endl;
+    return failures;
+}
+
+vector<filesystem::path> corpusFiles(const filesystem::path& directory) {
+    vector<filesystem::path> files;
+    for (const auto & file : filesystem::recursive_directory_iterator(directory)) {
+        if (file.is_regular_file() && file.path().extension() == ".java") {
+            files.push_back(file.path());
+        }
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+int main(int argc, char** argv) {
+    // Dead extractor workers surface as failed writes instead of killing the program
+    signal(SIGPIPE, SIG_IGN);
+    string corpus;
+    int repetitions = 5;
+    int vertexes = 2000;
+    unsigned seed = 42;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--repetitions" && i + 1 < argc) repetitions = stoi(argv[++i]);
+        else if (arg == "--vertexes" && i + 1 < argc) vertexes = stoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = stoul(argv[++i]);
+        else if (arg == "--corpus" && i + 1 < argc) corpus = argv[++i];
+        else if (arg == "--check") return checkKernels(seed) ? 1 : 0;
+        else {
+            cerr << "Usage: benchmark [--check] [--corpus DIR] [--repetitions N] [--vertexes V] [--seed S]" << endl;
+            return 1;
+        }
+    }
+
+    cout << left << setw(44) << "benchmark" << right << setw(12) << "median ms" << setw(12) << "min ms"
+         << setw(12) << "mean ms" << setw(16) << "items/s" << endl;
+
+    // Graph construction
+    int labels = max(8, vertexes / 10);
+    report(measure("UGraph::addEdge (" + to_string(vertexes) + " vertexes)", repetitions, vertexes * 3.0, [&]() {
+        mt19937 rng(seed);
+        delete syntheticGraph(rng, vertexes, 3, labels);
+    }));
+    GraphArena arena;
+    report(measure("UGraph::addEdge (" + to_string(vertexes) + " vertexes, arena)", repetitions, vertexes * 3.0, [&]() {
+        mt19937 rng(seed);
+        syntheticGraph(rng, vertexes, 3, labels, &arena);
+        arena.release();
+    }));
+
+    mt19937 rng(seed);
+    unique_ptr<UGraph<string>> first(syntheticGraph(rng, vertexes, 3, labels));
+    unique_ptr<UGraph<string>> second(syntheticGraph(rng, vertexes, 3, labels));
+    vector<pair<int, string>> vertexList = first->getVertexes();
+
+    // Label histogram, rebuilt (first query after building) and cached
+    report(measure("UGraph::getConnectionsFrom (cold, incl. copy)", repetitions, 1, [&]() {
+        UGraph<string> copy(*first);
+        copy.addEdge(vertexList[0], vertexList[1]);
+        copy.getConnectionsFrom(vertexList[0].second);
+    }));
+    report(measure("UGraph::getConnectionsFrom (cached, all labels)", repetitions, vertexList.size(), [&]() {
+        for (const auto& vertex : vertexList) first->getConnectionsFrom(vertex.second);
+    }));
+
+    // Extractor output: text lines against the binary wire format of the same graph
+    string text = "Nodes in CFG:\n", binary = GraphSerializer::serialize(*first);
+    for (const auto& vertex : vertexList) text += "n" + to_string(vertex.first) + " " + vertex.second + "\n";
+    text += "\nEdges in CFG:\n";
+    for (const auto& vertex : first->getEdges()) {
+        for (const auto& successor : vertex.second) {
+            text += "n" + to_string(vertex.first.first) + " n" + to_string(successor.first) + "\n";
+        }
+    }
+    for (const string* output : {&text, &binary}) {
+        report(measure(string("CFGStreamParser (") + (output == &text ? "text" : "binary") + ", " + to_string(output->size() >> 10) + " KiB)", repetitions, vertexes * 3.0, [&]() {
+            CFGStreamParser parser(GraphArena::create(&arena, true));
+            parser.feed(output->data(), output->size());
+            parser.finish();
+            arena.release();
+        }));
+    }
+
+    // Similarity
+    SimilarityService similarity;
+    report(measure("SimilarityService::getSimilarity", repetitions, 1, [&]() {
+        similarity.getSimilarity(first.get(), second.get());
+    }));
+    CSRGraph frozenFirst(*first), frozenSecond(*second);
+    TransitionVector firstMatrix(frozenFirst), secondMatrix(frozenSecond);
+    report(measure("SimilarityService::getSimilarity (prepared)", repetitions, 1, [&]() {
+        similarity.getSimilarity(firstMatrix, secondMatrix);
+    }));
+    // All pairs of a set of graphs against the plagiarism cutoff
+    vector<TransitionVector> graphs;
+    vector<GraphFingerprint> fingerprints;
+    for (int i = 0; i < 64; i += 2) {
+        unique_ptr<UGraph<string>> graph(syntheticGraph(rng, 200, 3, 20 + i % 40));
+        CSRGraph frozen(*graph);
+        graphs.push_back(TransitionVector(frozen));
+        fingerprints.push_back(GraphFingerprint(frozen));
+
+        // A lightly edited copy, so that some pairs pass the cutoff
+        vector<pair<int, string>> nodes = graph->getVertexes();
+        for (int e = 0; e < 10; e++) graph->addEdge(nodes[rng() % nodes.size()], nodes[rng() % nodes.size()]);
+        CSRGraph edited(*graph);
+        graphs.push_back(TransitionVector(edited));
+        fingerprints.push_back(GraphFingerprint(edited));
+    }
+    double graphPairs = graphs.size() * (graphs.size() - 1) / 2.0;
+    size_t exactPassing = 0, boundPassing = 0;
+    report(measure("SimilarityService::getSimilarity (all pairs)", repetitions, graphPairs, [&]() {
+        exactPassing = 0;
+        for (size_t i = 0; i < graphs.size(); i++)
+            for (size_t j = i + 1; j < graphs.size(); j++) exactPassing += similarity.getSimilarity(graphs[i], graphs[j]) >= 0.75;
+    }));
+    report(measure("SimilarityService::similarityAtLeast (0.75, all pairs)", repetitions, graphPairs, [&]() {
+        boundPassing = 0;
+        for (size_t i = 0; i < graphs.size(); i++)
+            for (size_t j = i + 1; j < graphs.size(); j++) boundPassing += similarity.similarityAtLeast(graphs[i], graphs[j], 0.75) >= 0.75;
+    }));
+    if (exactPassing != boundPassing) {
+        cerr << "similarityAtLeast kept " << boundPassing << " pairs, getSimilarity " << exactPassing << endl;
+    }
+
+    // The same set submitted twice: duplicates are grouped by fingerprint
+    size_t fingerprintLevels = 0;
+    report(measure("GraphFingerprint (" + to_string(vertexes) + " vertexes)", repetitions, vertexes, [&]() {
+        fingerprintLevels += GraphFingerprint(frozenFirst).levels();
+    }));
+    vector<TransitionVector> submitted(graphs);
+    vector<GraphFingerprint> submittedPrints(fingerprints);
+    submitted.insert(submitted.end(), graphs.begin(), graphs.end());
+    submittedPrints.insert(submittedPrints.end(), fingerprints.begin(), fingerprints.end());
+    double submittedPairs = submitted.size() * (submitted.size() - 1) / 2.0;
+    string submittedName = to_string(submitted.size()) + " graphs, " + to_string(graphs.size()) + " distinct";
+    CorpusService duplicateCorpus;
+    size_t allPassing = 0, uniquePassing = 0, filteredPassing = 0;
+    report(measure("CorpusService::compareAll (" + submittedName + ")", repetitions, submittedPairs, [&]() {
+        allPassing = duplicateCorpus.compareAll(submitted, 0.75, 1).size();
+    }));
+    report(measure("CorpusService::compareUnique (" + submittedName + ")", repetitions, submittedPairs, [&]() {
+        uniquePassing = duplicateCorpus.compareUnique(submitted, submittedPrints, 0.75, 0.0, 1).size();
+    }));
+    report(measure("CorpusService::compareUnique (WL overlap >= 0.5)", repetitions, submittedPairs, [&]() {
+        filteredPassing = duplicateCorpus.compareUnique(submitted, submittedPrints, 0.75, 0.5, 1).size();
+    }));
+    if (allPassing != uniquePassing) {
+        cerr << "compareUnique kept " << uniquePassing << " pairs, compareAll " << allPassing << endl;
+    }
+    cout << "WL pre-filter kept " << filteredPassing << " of " << uniquePassing << " passing pairs" << endl;
+
+    if (vertexes <= 5000) {
+        report(measure(string("SimilarityService::getDenseSimilarity (") + CosineKernel::name(CosineKernel::best()) + ")", repetitions, 1, [&]() {
+            similarity.getDenseSimilarity(frozenFirst, frozenSecond);
+        }));
+        report(measure("SimilarityService::getDenseSimilarity (float)", repetitions, 1, [&]() {
+            similarity.getDenseSimilarity(frozenFirst, frozenSecond, true);
+        }));
+    }
+
+    if (corpus.empty()) {
+        cout << "\nNo --corpus given: skipping extraction and corpus throughput "
+             << "(generate one with tools/corpusGenerator.py)" << endl;
+        return 0;
+    }
+
+    // CFG extraction
+    vector<filesystem::path> files = corpusFiles(corpus);
+    if (files.empty()) {
+        cerr << "No .java files in " << corpus << endl;
+        return 1;
+    }
+
+    report(measure("CFGBuilderService::build (" + to_string(files.size()) + " files)", repetitions, files.size(), [&]() {
+        CFGBuilderService builder;
+        for (filesystem::path& file : files) delete builder.build(file);
+    }));
+
+    // End-to-end corpus throughput
+    CorpusService corpusService;
+    CFGBuilderController cfgBuilderController(max(1u, thread::hardware_concurrency()));
+    auto getGraph = [&](filesystem::path& file, GraphArena* arena) { return cfgBuilderController.getGraph(file, arena); };
+    vector<TransitionVector> matrices;
+
+    report(measure("CorpusService::prepare (files)", repetitions, files.size(), [&]() {
+        matrices = corpusService.prepare(files, getGraph);
+    }));
+    double pairs = files.size() * (files.size() - 1) / 2.0;
+    report(measure("CorpusService::compareAll (pairs)", repetitions, pairs, [&]() {
+        corpusService.compareAll(matrices, 0.75);
+    }));
+
+    // Vocabulary before and after label normalization
+    set<string> raw, normalized;
+    GraphArena vocabularyArena;
+    for (filesystem::path& file : files) {
+        UGraph<string>* graph = cfgBuilderController.getGraph(file, &vocabularyArena);
+        if (!graph) continue;
+        for (const auto& vertex : graph->getEdges()) {
+            raw.insert(string(vertex.first.second));
+            normalized.insert(LabelNormalizer::java().normalize(vertex.first.second));
+        }
+        vocabularyArena.release();
+    }
+    cout << "\nCorpus vocabulary: " << raw.size() << " labels, " << normalized.size() << " after normalization" << endl;
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "UGraph.h"
+#include "TokenDictionary.h"
+
+
+/**
+ * @class CSRGraph
+ * @brief Frozen, read-only form of a UGraph: interned vertex labels plus
+ *        compressed sparse row adjacency (offsets + targets).
+ */
+class CSRGraph {
+    private:
+        std::vector<uint32_t> labels;
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> targets;
+
+    public:
+        typedef std::function<std::string(std::string_view)> Normalizer;
+
+        CSRGraph();
+        CSRGraph(const UGraph<std::string>&, TokenDictionary& = TokenDictionary::global(), const Normalizer& = nullptr);
+        ~CSRGraph();
+        size_t vertexCount() const;
+        size_t edgeCount() const;
+        uint32_t label(uint32_t) const;
+        const uint32_t* successorsBegin(uint32_t) const;
+        const uint32_t* successorsEnd(uint32_t) const;
+        std::vector<uint32_t> getTokens() const;
+};
+
+
+/**
+ * @brief Constructor for an empty CSRGraph.
+ */
+CSRGraph::CSRGraph() : offsets(1, 0) {}
+
+
+/**
+ * @brief Freeze a built UGraph. Vertexes keep the UGraph order (by id).
+ * @param graph Graph to freeze
+ * @param dictionary Dictionary used to intern the labels
+ * @param normalize Applied once to every distinct label before it is interned, nullptr to intern labels as they are
+ */
+CSRGraph::CSRGraph(const UGraph<std::string>& graph, TokenDictionary& dictionary, const Normalizer& normalize) {
+    const auto& edges = graph.getEdges();
+    std::map<int, uint32_t> index;
+    std::unordered_map<std::string_view, uint32_t> interned;
+
+    labels.reserve(edges.size());
+    for (const auto& vertex : edges) {
+        index[vertex.first.first] = labels.size();
+        auto it = interned.find(vertex.first.second);
+        if (it == interned.end()) {
+            std::string_view label = vertex.first.second;
+            it = interned.emplace(label, dictionary.intern(normalize ? normalize(label) : std::string(label))).first;
+        }
+        labels.push_back(it->second);
+    }
+
+    offsets.reserve(edges.size() + 1);
+    offsets.push_back(0);
+    for (const auto& vertex : edges) {
+        for (const auto& successor : vertex.second) {
+            targets.push_back(index[successor.first]);
+        }
+        offsets.push_back(targets.size());
+    }
+}
+
+
+/**
+ * @brief Destructor for the CSRGraph class.
+ */
+CSRGraph::~CSRGraph(){}
+
+
+/**
+ * @brief Number of vertexes.
+ */
+size_t CSRGraph::vertexCount() const {
+    return labels.size();
+}
+
+
+/**
+ * @brief Number of edges.
+ */
+size_t CSRGraph::edgeCount() const {
+    return targets.size();
+}
+
+
+/**
+ * @brief Interned label of a vertex.
+ * @param vertex Vertex index
+ * @return Token id in the dictionary the graph was frozen with
+ */
+uint32_t CSRGraph::label(uint32_t vertex) const {
+    return labels[vertex];
+}
+
+
+/**
+ * @brief First successor of a vertex.
+ * @param vertex Vertex index
+ */
+const uint32_t* CSRGraph::successorsBegin(uint32_t vertex) const {
+    return targets.data() + offsets[vertex];
+}
+
+
+/**
+ * @brief One past the last successor of a vertex.
+ * @param vertex Vertex index
+ */
+const uint32_t* CSRGraph::successorsEnd(uint32_t vertex) const {
+    return targets.data() + offsets[vertex + 1];
+}
+
+
+/**
+ * @brief Distinct token ids used by the graph.
+ * @return Sorted token ids
+ */
+std::vector<uint32_t> CSRGraph::getTokens() const {
+    std::vector<uint32_t> tokens(labels);
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    return tokens;
+}
+
+#endif // CSRGRAPH_H
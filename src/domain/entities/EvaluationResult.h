@@ -0,0 +1,37 @@
+#ifndef EVALUATIONRESULT_H
+#define EVALUATIONRESULT_H
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @struct CaseResult
+ * @brief Scores of one test case: its original file against every plagiarized
+ *        and non-plagiarized file, with the detections that matched the expectation.
+ */
+struct CaseResult {
+    std::string name;
+    std::filesystem::path original;
+    std::vector<std::pair<std::filesystem::path, double>> plagiarized;
+    std::vector<std::pair<std::filesystem::path, double>> nonPlagiarized;
+    int successPlag = 0, totalPlag = 0;
+    int successNonPlag = 0, totalNonPlag = 0;
+    int errors = 0;
+};
+
+
+/**
+ * @struct EvaluationSummary
+ * @brief Totals of a whole dataset run.
+ */
+struct EvaluationSummary {
+    size_t cases = 0;
+    int successPlag = 0, totalPlag = 0;
+    int successNonPlag = 0, totalNonPlag = 0;
+    int errors = 0;
+};
+
+#endif // EVALUATIONRESULT_H
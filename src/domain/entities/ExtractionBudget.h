@@ -0,0 +1,20 @@
+#ifndef EXTRACTIONBUDGET_H
+#define EXTRACTIONBUDGET_H
+
+#include <cstddef>
+
+
+/**
+ * @struct ExtractionBudget
+ * @brief Per-file limits on CFG extraction. An extractor that goes over any of them is killed
+ *        and the file is skipped. 0 means no limit.
+ */
+struct ExtractionBudget {
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+    size_t rssBytes = 0;
+
+    bool unlimited() const { return !wallSeconds && !cpuSeconds && !rssBytes; }
+};
+
+#endif // EXTRACTIONBUDGET_H
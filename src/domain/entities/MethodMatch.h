@@ -0,0 +1,19 @@
+#ifndef METHODMATCH_H
+#define METHODMATCH_H
+
+#include <filesystem>
+#include <string>
+
+
+/**
+ * @struct MethodMatch
+ * @brief A method of a query file that resembles a method of a corpus file.
+ */
+struct MethodMatch {
+    std::string queryMethod;
+    std::filesystem::path file;
+    std::string method;
+    double score;
+};
+
+#endif // METHODMATCH_H
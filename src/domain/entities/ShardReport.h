@@ -0,0 +1,21 @@
+#ifndef SHARDREPORT_H
+#define SHARDREPORT_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @struct ShardReport
+ * @brief Totals of a sharded all-pairs run: tiles handed to workers, how many had to be
+ *        retried or were given up, the pairs the workers scored and the wall-clock time.
+ */
+struct ShardReport {
+    size_t tiles = 0;
+    size_t retries = 0;
+    size_t failed = 0;
+    uint64_t pairs = 0;
+    double seconds = 0;
+};
+
+#endif // SHARDREPORT_H
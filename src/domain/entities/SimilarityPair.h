@@ -0,0 +1,17 @@
+#ifndef SIMILARITYPAIR_H
+#define SIMILARITYPAIR_H
+
+#include <cstddef>
+
+
+/**
+ * @struct SimilarityPair
+ * @brief Score of two corpus entries, referenced by their index in the corpus.
+ */
+struct SimilarityPair {
+    size_t first;
+    size_t second;
+    double score;
+};
+
+#endif // SIMILARITYPAIR_H
@@ -0,0 +1,103 @@
+#ifndef TOKENDICTIONARY_H
+#define TOKENDICTIONARY_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+
+/**
+ * @class TokenDictionary
+ * @brief Interning table that maps CFG vertex labels to dense uint32 ids.
+ *        Safe to share between threads; ids never change once assigned.
+ */
+class TokenDictionary {
+    private:
+        mutable std::shared_mutex lock;
+        std::unordered_map<std::string, uint32_t> ids;
+        std::deque<std::string> tokens;
+
+    public:
+        TokenDictionary();
+        ~TokenDictionary();
+        static TokenDictionary& global();
+        uint32_t intern(const std::string&);
+        const std::string& token(uint32_t) const;
+        size_t size() const;
+};
+
+
+/**
+ * @brief Constructor for the TokenDictionary class.
+ */
+TokenDictionary::TokenDictionary(){}
+
+
+/**
+ * @brief Destructor for the TokenDictionary class.
+ */
+TokenDictionary::~TokenDictionary(){}
+
+
+/**
+ * @brief Process-wide dictionary, so ids are comparable between every graph.
+ * @return Shared dictionary
+ */
+TokenDictionary& TokenDictionary::global() {
+    static TokenDictionary dictionary;
+    return dictionary;
+}
+
+
+/**
+ * @brief Get the id of a label, assigning the next free id the first time it is seen.
+ * @param label Vertex label
+ * @return Interned id
+ */
+uint32_t TokenDictionary::intern(const std::string& label) {
+    {
+        std::shared_lock<std::shared_mutex> reader(lock);
+        auto it = ids.find(label);
+        if (it != ids.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> writer(lock);
+    auto inserted = ids.emplace(label, (uint32_t) tokens.size());
+    if (inserted.second) {
+        tokens.push_back(label);
+    }
+    return inserted.first->second;
+}
+
+
+/**
+ * @brief Get the label of an interned id.
+ * @param id Interned id
+ * @throws std::out_of_range if the id was never assigned.
+ * @return Label
+ */
+const std::string& TokenDictionary::token(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> reader(lock);
+    if (id >= tokens.size()) {
+        throw std::out_of_range("TokenDictionary: unknown token id");
+    }
+    return tokens[id];
+}
+
+
+/**
+ * @brief Number of interned labels.
+ * @return Dictionary size
+ */
+size_t TokenDictionary::size() const {
+    std::shared_lock<std::shared_mutex> reader(lock);
+    return tokens.size();
+}
+
+#endif // TOKENDICTIONARY_H
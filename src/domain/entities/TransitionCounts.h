@@ -0,0 +1,168 @@
+#ifndef TRANSITIONCOUNTS_H
+#define TRANSITIONCOUNTS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "CSRGraph.h"
+
+
+/**
+ * @class TransitionCounts
+ * @brief Raw (not yet normalized) label -> successor label transition counts, stored as
+ *        sorted (row, column) keys like TransitionVector. Counts of separate sub-graphs
+ *        (e.g. the methods of a file) add up to the counts of their union, so a file's
+ *        counts can be updated by adding and subtracting the counts of changed methods.
+ */
+class TransitionCounts {
+    private:
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> counts;
+
+        void merge(const TransitionCounts&, bool);
+
+    public:
+        TransitionCounts();
+        TransitionCounts(std::vector<uint64_t>);
+        TransitionCounts(const CSRGraph&);
+        ~TransitionCounts();
+        static uint64_t key(uint32_t, uint32_t);
+        void add(const TransitionCounts&);
+        void subtract(const TransitionCounts&);
+        size_t size() const;
+        const std::vector<uint64_t>& getKeys() const;
+        const std::vector<uint32_t>& getCounts() const;
+};
+
+
+/**
+ * @brief Constructor for empty TransitionCounts.
+ */
+TransitionCounts::TransitionCounts(){}
+
+
+/**
+ * @brief Count a list of transitions.
+ * @param transitions One key(row, column) per edge, in any order
+ */
+TransitionCounts::TransitionCounts(std::vector<uint64_t> transitions) {
+    std::sort(transitions.begin(), transitions.end());
+    for (uint64_t transition : transitions) {
+        if (keys.empty() || keys.back() != transition) {
+            keys.push_back(transition);
+            counts.push_back(0);
+        }
+        counts.back()++;
+    }
+}
+
+
+/**
+ * @brief Count every label -> successor label transition of a graph.
+ * @param graph Frozen CFG
+ */
+TransitionCounts::TransitionCounts(const CSRGraph& graph) {
+    std::vector<uint64_t> transitions;
+    transitions.reserve(graph.edgeCount());
+    for (uint32_t v = 0; v < graph.vertexCount(); v++) {
+        for (const uint32_t* it = graph.successorsBegin(v); it != graph.successorsEnd(v); it++) {
+            transitions.push_back(key(graph.label(v), graph.label(*it)));
+        }
+    }
+    *this = TransitionCounts(std::move(transitions));
+}
+
+
+/**
+ * @brief Destructor for the TransitionCounts class.
+ */
+TransitionCounts::~TransitionCounts(){}
+
+
+/**
+ * @brief Pack a (row, column) pair so that keys sort row-major (same packing as TransitionVector).
+ */
+uint64_t TransitionCounts::key(uint32_t row, uint32_t column) {
+    return ((uint64_t) row << 32) | column;
+}
+
+
+/**
+ * @brief Add or subtract other counts in one merge pass. Keys whose count drops to 0 are removed.
+ * @throws std::logic_error if a subtraction would make a count negative.
+ */
+void TransitionCounts::merge(const TransitionCounts& other, bool subtracting) {
+    std::vector<uint64_t> mergedKeys;
+    std::vector<uint32_t> mergedCounts;
+    mergedKeys.reserve(keys.size() + other.keys.size());
+    mergedCounts.reserve(keys.size() + other.keys.size());
+
+    size_t i = 0, j = 0;
+    while (i < keys.size() || j < other.keys.size()) {
+        if (j == other.keys.size() || (i < keys.size() && keys[i] < other.keys[j])) {
+            mergedKeys.push_back(keys[i]);
+            mergedCounts.push_back(counts[i++]);
+            continue;
+        }
+
+        bool shared = i < keys.size() && keys[i] == other.keys[j];
+        uint32_t count = shared ? counts[i] : 0;
+        if (subtracting && count < other.counts[j]) {
+            throw std::logic_error("TransitionCounts: subtracting transitions that were never added");
+        }
+        count = subtracting ? count - other.counts[j] : count + other.counts[j];
+        if (count) {
+            mergedKeys.push_back(other.keys[j]);
+            mergedCounts.push_back(count);
+        }
+        if (shared) i++;
+        j++;
+    }
+
+    keys.swap(mergedKeys);
+    counts.swap(mergedCounts);
+}
+
+
+/**
+ * @brief Add the transitions of another sub-graph.
+ */
+void TransitionCounts::add(const TransitionCounts& other) {
+    merge(other, false);
+}
+
+
+/**
+ * @brief Remove the transitions of a sub-graph that was added before.
+ * @throws std::logic_error if some transition was not added before.
+ */
+void TransitionCounts::subtract(const TransitionCounts& other) {
+    merge(other, true);
+}
+
+
+/**
+ * @brief Number of distinct transitions.
+ */
+size_t TransitionCounts::size() const {
+    return keys.size();
+}
+
+
+/**
+ * @brief Sorted transition keys.
+ */
+const std::vector<uint64_t>& TransitionCounts::getKeys() const {
+    return keys;
+}
+
+
+/**
+ * @brief Transition counts, aligned with getKeys().
+ */
+const std::vector<uint32_t>& TransitionCounts::getCounts() const {
+    return counts;
+}
+
+#endif // TRANSITIONCOUNTS_H
@@ -0,0 +1,265 @@
+#ifndef TRANSITIONVECTOR_H
+#define TRANSITIONVECTOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "CSRGraph.h"
+#include "TransitionCounts.h"
+
+
+/**
+ * @class TransitionVector
+ * @brief Sparse Markov transition matrix of a CFG, stored as sorted (row, column) keys
+ *        over interned label ids. Each row holds the probabilities of moving from a
+ *        label to each successor label. The start and norm of every row are kept too,
+ *        so a cosine against a threshold can stop once the rows left cannot reach it.
+ */
+class TransitionVector {
+    private:
+        std::vector<uint64_t> keys;
+        std::vector<double> values;
+        std::vector<uint32_t> rows;
+        std::vector<uint32_t> rowStarts;
+        std::vector<double> rowNorms;
+        double norm;
+
+        void addRowDot(size_t, const TransitionVector&, size_t, double&) const;
+        double sharedRowBound(const TransitionVector&) const;
+
+    public:
+        TransitionVector();
+        TransitionVector(const CSRGraph&);
+        TransitionVector(const TransitionCounts&);
+        ~TransitionVector();
+        static uint64_t key(uint32_t, uint32_t);
+        static uint32_t row(uint64_t);
+        static uint32_t column(uint64_t);
+        size_t nonZeros() const;
+        double getNorm() const;
+        const std::vector<uint64_t>& getKeys() const;
+        const std::vector<double>& getValues() const;
+        double cosine(const TransitionVector&) const;
+        double cosineAtLeast(const TransitionVector&, double) const;
+};
+
+
+/**
+ * @brief Constructor for an empty TransitionVector.
+ */
+TransitionVector::TransitionVector() : rowStarts(1, 0), norm(0.0) {}
+
+
+/**
+ * @brief Count every label -> successor label transition of a graph and normalize each row.
+ * @param graph Frozen CFG
+ */
+TransitionVector::TransitionVector(const CSRGraph& graph) : TransitionVector(TransitionCounts(graph)) {}
+
+
+/**
+ * @brief Normalize each row of raw transition counts.
+ * @param counts Counts of a whole CFG
+ */
+TransitionVector::TransitionVector(const TransitionCounts& counts) : keys(counts.getKeys()), values(counts.getKeys().size()), norm(0.0) {
+    const std::vector<uint32_t>& raw = counts.getCounts();
+    size_t rowStart = 0;
+    double rowTotal = 0.0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (i && row(keys[i - 1]) != row(keys[i])) {
+            for (size_t j = rowStart; j < i; j++) values[j] /= rowTotal;
+            rowStart = i;
+            rowTotal = 0.0;
+        }
+        values[i] = raw[i];
+        rowTotal += raw[i];
+    }
+    for (size_t j = rowStart; j < values.size(); j++) values[j] /= rowTotal;
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (!i || row(keys[i - 1]) != row(keys[i])) {
+            rows.push_back(row(keys[i]));
+            rowStarts.push_back(i);
+            rowNorms.push_back(0.0);
+        }
+        rowNorms.back() += values[i] * values[i];
+        norm += values[i] * values[i];
+    }
+    rowStarts.push_back(keys.size());
+    for (double& rowNorm : rowNorms) {
+        rowNorm = sqrt(rowNorm);
+    }
+    norm = sqrt(norm);
+}
+
+
+/**
+ * @brief Destructor for the TransitionVector class.
+ */
+TransitionVector::~TransitionVector(){}
+
+
+/**
+ * @brief Pack a (row, column) pair so that keys sort row-major.
+ */
+uint64_t TransitionVector::key(uint32_t row, uint32_t column) {
+    return ((uint64_t) row << 32) | column;
+}
+
+
+/**
+ * @brief Row (source label) of a key.
+ */
+uint32_t TransitionVector::row(uint64_t key) {
+    return key >> 32;
+}
+
+
+/**
+ * @brief Column (successor label) of a key.
+ */
+uint32_t TransitionVector::column(uint64_t key) {
+    return key & 0xFFFFFFFFu;
+}
+
+
+/**
+ * @brief Number of stored (non-zero) transitions.
+ */
+size_t TransitionVector::nonZeros() const {
+    return keys.size();
+}
+
+
+/**
+ * @brief Euclidean norm of the flattened matrix.
+ */
+double TransitionVector::getNorm() const {
+    return norm;
+}
+
+
+/**
+ * @brief Sorted transition keys.
+ */
+const std::vector<uint64_t>& TransitionVector::getKeys() const {
+    return keys;
+}
+
+
+/**
+ * @brief Transition probabilities, aligned with getKeys().
+ */
+const std::vector<double>& TransitionVector::getValues() const {
+    return values;
+}
+
+
+/**
+ * @brief Cosine between two transition matrices by merging their sorted keys, O(nnz).
+ * @param other Matrix to compare
+ * @return Similarity between 0 and 1
+ */
+double TransitionVector::cosine(const TransitionVector& other) const {
+    if (!norm || !other.norm)
+        return 0.0;
+
+    double dot = 0.0;
+    size_t i = 0, j = 0;
+    while (i < keys.size() && j < other.keys.size()) {
+        if (keys[i] < other.keys[j]) {
+            i++;
+        } else if (other.keys[j] < keys[i]) {
+            j++;
+        } else {
+            dot += values[i++] * other.values[j++];
+        }
+    }
+
+    return dot / (norm * other.norm);
+}
+
+
+/**
+ * @brief Add the dot product of one row of this matrix with one row of another (same label).
+ *        Products are added to the running sum one by one, in key order, as cosine() does.
+ * @param r Row index in this matrix
+ * @param other Matrix to compare
+ * @param q Row index in other
+ * @param dot Running dot product
+ */
+void TransitionVector::addRowDot(size_t r, const TransitionVector& other, size_t q, double& dot) const {
+    size_t i = rowStarts[r], j = other.rowStarts[q];
+    while (i < rowStarts[r + 1] && j < other.rowStarts[q + 1]) {
+        if (keys[i] < other.keys[j]) {
+            i++;
+        } else if (other.keys[j] < keys[i]) {
+            j++;
+        } else {
+            dot += values[i++] * other.values[j++];
+        }
+    }
+}
+
+
+/**
+ * @brief Upper bound of the dot product: only rows of labels both graphs have contribute,
+ *        and each at most the product of the two row norms (Cauchy-Schwarz).
+ */
+double TransitionVector::sharedRowBound(const TransitionVector& other) const {
+    double bound = 0.0;
+    size_t r = 0, q = 0;
+    while (r < rows.size() && q < other.rows.size()) {
+        if (rows[r] < other.rows[q]) {
+            r++;
+        } else if (other.rows[q] < rows[r]) {
+            q++;
+        } else {
+            bound += rowNorms[r++] * other.rowNorms[q++];
+        }
+    }
+    return bound;
+}
+
+
+/**
+ * @brief Cosine between two transition matrices when it may reach a threshold.
+ *        Shared rows are visited in order while the bound of the rows left is tracked, and the
+ *        scan stops as soon as the exact part plus that bound falls below the threshold.
+ * @param other Matrix to compare
+ * @param threshold Score the caller needs
+ * @return The exact cosine (same value as cosine()) if it is at least threshold,
+ *         otherwise some value below threshold
+ */
+double TransitionVector::cosineAtLeast(const TransitionVector& other, double threshold) const {
+    if (!norm || !other.norm)
+        return 0.0;
+
+    // Slack so that rounding in the running bound never rejects a pair that passes
+    double needed = threshold * norm * other.norm * (1.0 - 1e-9);
+    double remaining = sharedRowBound(other);
+    if (remaining < needed) {
+        return remaining / (norm * other.norm);
+    }
+
+    double dot = 0.0;
+    size_t r = 0, q = 0;
+    while (r < rows.size() && q < other.rows.size()) {
+        if (rows[r] < other.rows[q]) {
+            r++;
+        } else if (other.rows[q] < rows[r]) {
+            q++;
+        } else {
+            remaining -= rowNorms[r] * other.rowNorms[q];
+            addRowDot(r++, other, q++, dot);
+            if (dot + std::max(remaining, 0.0) < needed) {
+                return (dot + std::max(remaining, 0.0)) / (norm * other.norm);
+            }
+        }
+    }
+
+    return dot / (norm * other.norm);
+}
+
+#endif // TRANSITIONVECTOR_H
@@ -6,37 +6,92 @@
 #include <sstream>
 #include <set>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include<vector>
 
 
+/**
+ * @struct ArenaLabel
+ * @brief How UGraph stores vertex labels: strings are kept as std::pmr::string so their
+ *        characters live in the graph's memory resource along with the nodes.
+ */
+template<class Vertex>
+struct ArenaLabel {
+    using type = Vertex;
+    static type make(const Vertex& label, std::pmr::memory_resource*) { return label; }
+};
+
+template<>
+struct ArenaLabel<std::string> {
+    using type = std::pmr::string;
+    static type make(const std::string& label, std::pmr::memory_resource* resource) { return type(label, resource); }
+    static type make(std::string_view label, std::pmr::memory_resource* resource) { return type(label, resource); }
+};
+
+
 /**
  * @class UGraph
  * @brief This class represents a CFG.
+ *        Vertex sets, adjacency and labels are allocated from a memory resource, so graphs
+ *        built in a GraphArena are released with the arena instead of node by node.
  */
 template<class Vertex>
 class UGraph {
+    public:
+        using Label = typename ArenaLabel<Vertex>::type;
+        using Node = std::pair<int, Label>;
+        using NodeSet = std::pmr::set<Node>;
+        using Adjacency = std::pmr::map<Node, NodeSet>;
+        using Histogram = std::pmr::unordered_map<Label, std::pmr::vector<std::pair<int, Label>>>;
+
     private:
         bool direction;
-        std::set<std::pair<int, Vertex>> vertexes;
-        std::map<std::pair<int, Vertex>, std::set<std::pair<int, Vertex>>> edges;
-    
+        std::pmr::memory_resource* resource;
+        NodeSet vertexes;
+        Adjacency edges;
+        mutable std::shared_ptr<const Histogram> transitions;
+
+        template<class Key>
+        Node node(int, const Key&) const;
+
     public:
-        UGraph(bool direction = true);
+        UGraph(bool direction = true, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+        UGraph(const UGraph&);
+        UGraph& operator=(const UGraph&) = delete;
         ~UGraph();
-        void addEdge(std::pair<int, Vertex>, std::pair<int, Vertex>);
+        void addEdge(const std::pair<int, Vertex>&, const std::pair<int, Vertex>&);
+        template<class Key>
+        void addEdge(int, const Key&, int, const Key&);
         std::vector<std::pair<int, Vertex>> getVertexes() const;
+        const Adjacency& getEdges() const;
         std::vector<std::pair<int, Vertex>> getConnectionsFrom(std::string) const;
+        std::shared_ptr<const Histogram> getTransitions() const;
         std::string toString() const;
 };
 
 
 /**
  * @brief Constructor for the UGraph class (defaults to a directed graph).
+ * @param direction Whether edges are directed
+ * @param resource Memory resource for every node and label of the graph
  */
 template<class Vertex>
-UGraph<Vertex>::UGraph(bool direction) {
-    this->direction = direction;
-}
+UGraph<Vertex>::UGraph(bool direction, std::pmr::memory_resource* resource)
+    : direction(direction), resource(resource), vertexes(resource), edges(resource) {}
+
+
+/**
+ * @brief Copy a graph onto the default memory resource, so it outlives the original's arena.
+ * @param other Graph to copy
+ */
+template<class Vertex>
+UGraph<Vertex>::UGraph(const UGraph& other)
+    : direction(other.direction), resource(std::pmr::get_default_resource()),
+      vertexes(other.vertexes, resource), edges(other.edges, resource) {}
 
 
 /**
@@ -53,26 +108,47 @@ UGraph<Vertex>::~UGraph(){}
  *             If the graph is undirected, it will also store the vertex where the connection originates
  */
 template<class Vertex>
-void UGraph<Vertex>::addEdge(std::pair<int, Vertex> from, std::pair<int, Vertex> to){
-    typename std::set<std::pair<int, Vertex>>::iterator it;
+void UGraph<Vertex>::addEdge(const std::pair<int, Vertex>& from, const std::pair<int, Vertex>& to){
+    addEdge(from.first, from.second, to.first, to.second);
+}
 
-    it = vertexes.find(from);
-    if (it == vertexes.end()) {
-        vertexes.insert(from);
-        edges.insert(std::make_pair(from, std::set<std::pair<int, Vertex>>()));
-    }
 
-    it = vertexes.find(to);
-    if (it == vertexes.end()) {
-        vertexes.insert(to);
-        edges.insert(std::make_pair(to, std::set<std::pair<int, Vertex>>()));
-    }
+/**
+ * @brief Add connection between vertexes given by id and label. The label may be any type
+ *        the stored label is built from (e.g. std::string_view into a read buffer), so it is
+ *        copied once, straight into the graph's memory resource.
+ * @param fromId Id of the vertex where the connection originates
+ * @param fromLabel Its label
+ * @param toId Id of the vertex where the connection will be stored
+ * @param toLabel Its label
+ */
+template<class Vertex>
+template<class Key>
+void UGraph<Vertex>::addEdge(int fromId, const Key& fromLabel, int toId, const Key& toLabel){
+    // Map keys are moved in: a map node copies its key as a nested pair, which does not pass
+    // the memory resource on to the label. Set elements are plain pairs, so copies are fine.
+    auto source = edges.try_emplace(node(fromId, fromLabel)).first;
+    auto target = edges.try_emplace(node(toId, toLabel)).first;
+    vertexes.insert(source->first);
+    vertexes.insert(target->first);
 
-    edges[from].insert(to);
+    source->second.insert(target->first);
 
     if (!direction){
-        edges[to].insert(from);
+        target->second.insert(source->first);
     }
+
+    transitions.reset();
+}
+
+
+/**
+ * @brief A vertex with its label stored in the graph's memory resource.
+ */
+template<class Vertex>
+template<class Key>
+typename UGraph<Vertex>::Node UGraph<Vertex>::node(int id, const Key& label) const {
+    return Node(id, ArenaLabel<Vertex>::make(label, resource));
 }
 
 /**
@@ -81,33 +157,73 @@ void UGraph<Vertex>::addEdge(std::pair<int, Vertex> from, std::pair<int, Vertex>
  */
 template<class Vertex>
 std::vector<std::pair<int, Vertex>> UGraph<Vertex>::getVertexes() const{
-    std::vector<std::pair<int, Vertex>> result(vertexes.begin(), vertexes.end());
+    std::vector<std::pair<int, Vertex>> result;
+    result.reserve(vertexes.size());
+    for (const Node& vertex : vertexes) {
+        result.push_back(std::make_pair(vertex.first, Vertex(vertex.second)));
+    }
 	return result;
 }
 
+/**
+ * @brief This method gets the adjacency of every vertex.
+ * @return Map from vertex to its successors
+ */
+template<class Vertex>
+const typename UGraph<Vertex>::Adjacency& UGraph<Vertex>::getEdges() const{
+    return edges;
+}
+
 /**
  * @brief Get connections for a given tag
  * @return Vector with count for a given vertex
  */
 template<class Vertex>
 std::vector<std::pair<int, Vertex>> UGraph<Vertex>::getConnectionsFrom(std::string tag) const {
-    std::vector<std::pair<int, Vertex>> ret;
-    std::map<Vertex,int> connections;
-    typename std::map<Vertex,int>::iterator it;
+    auto histogram = getTransitions();
+    auto it = histogram->find(ArenaLabel<Vertex>::make(tag, std::pmr::get_default_resource()));
+
+    std::vector<std::pair<int, Vertex>> result;
+    if (it == histogram->end()) {
+        return result;
+    }
+    for (const auto& connection : it->second) {
+        result.push_back(std::make_pair(connection.first, Vertex(connection.second)));
+    }
+    return result;
+}
 
+/**
+ * @brief Successor label counts of every label, built in one pass over the edges
+ *        and cached, in the graph's memory resource, until the next addEdge.
+ *        Like addEdge, the first call after a change must not race with other calls on the
+ *        graph; call it once before sharing a finished graph between threads.
+ * @return Map from label to (count, successor label), ordered by successor label
+ */
+template<class Vertex>
+std::shared_ptr<const typename UGraph<Vertex>::Histogram> UGraph<Vertex>::getTransitions() const {
+    if (transitions) {
+        return transitions;
+    }
+
+    std::pmr::map<Label, std::pmr::map<Label, int>> counts(resource);
     for (const auto& pair : edges) {
-        if (pair.first.second == tag){
-            for (const auto& nodeConnections : pair.second) {
-                connections[nodeConnections.second]++;
-            }
+        std::pmr::map<Label, int>& connections = counts[pair.first.second];
+        for (const auto& nodeConnections : pair.second) {
+            connections[nodeConnections.second]++;
         }
     }
 
-    for (const auto& pair : connections) {
-        ret.push_back(std::make_pair(pair.second, pair.first));
+    auto histogram = std::allocate_shared<Histogram>(std::pmr::polymorphic_allocator<Histogram>(resource));
+    for (const auto& label : counts) {
+        auto& ret = (*histogram)[label.first];
+        for (const auto& pair : label.second) {
+            ret.emplace_back(pair.second, pair.first);
+        }
     }
 
-    return ret;
+    transitions = histogram;
+    return transitions;
 }
 
 /**
@@ -117,12 +233,12 @@ std::vector<std::pair<int, Vertex>> UGraph<Vertex>::getConnectionsFrom(std::stri
 template<class Vertex>
 std::string UGraph<Vertex>::toString() const {
     std::stringstream ss;
-    typename std::set<std::pair<int, Vertex>>::iterator vertexItr, edgeItr;
+    typename NodeSet::const_iterator vertexItr, edgeItr;
     
     for(vertexItr = vertexes.begin(); vertexItr != vertexes.end(); vertexItr++) {
         ss << "Vertex " << vertexItr->first << ": " << vertexItr->second << "\nConnections:\n";
 
-        for(edgeItr = edges.at(std::make_pair(vertexItr->first,vertexItr->second)).begin(); edgeItr != edges.at(std::make_pair(vertexItr->first,vertexItr->second)).end(); edgeItr++) {
+        for(edgeItr = edges.at(*vertexItr).begin(); edgeItr != edges.at(*vertexItr).end(); edgeItr++) {
             ss << "(" << edgeItr->first << "," << edgeItr->second << ")" << "\n";
         }
         ss << "\n\n";
@@ -0,0 +1,98 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+
+/**
+ * @class BoundedQueue
+ * @brief Blocking multi-producer/multi-consumer queue with a fixed capacity.
+ *        Producers wait while it is full; close() wakes every consumer once it drains.
+ */
+template<class T>
+class BoundedQueue {
+    private:
+        size_t capacity;
+        bool closed;
+        std::deque<T> items;
+        std::mutex lock;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+
+    public:
+        BoundedQueue(size_t);
+        ~BoundedQueue();
+        bool push(T);
+        bool pop(T&);
+        void close();
+};
+
+
+/**
+ * @brief Constructor for the BoundedQueue class.
+ * @param capacity Maximum number of queued items
+ */
+template<class T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) : capacity(capacity ? capacity : 1), closed(false) {}
+
+
+/**
+ * @brief Destructor for the BoundedQueue class.
+ */
+template<class T>
+BoundedQueue<T>::~BoundedQueue(){}
+
+
+/**
+ * @brief Enqueue an item, waiting for room.
+ * @param item Item to enqueue
+ * @return False if the queue was closed
+ */
+template<class T>
+bool BoundedQueue<T>::push(T item) {
+    std::unique_lock<std::mutex> guard(lock);
+    notFull.wait(guard, [this]() { return closed || items.size() < capacity; });
+    if (closed) {
+        return false;
+    }
+
+    items.push_back(std::move(item));
+    notEmpty.notify_one();
+    return true;
+}
+
+
+/**
+ * @brief Dequeue an item, waiting for one.
+ * @param item Receives the item
+ * @return False once the queue is closed and empty
+ */
+template<class T>
+bool BoundedQueue<T>::pop(T& item) {
+    std::unique_lock<std::mutex> guard(lock);
+    notEmpty.wait(guard, [this]() { return closed || !items.empty(); });
+    if (items.empty()) {
+        return false;
+    }
+
+    item = std::move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+}
+
+
+/**
+ * @brief Stop accepting items; consumers drain what is left.
+ */
+template<class T>
+void BoundedQueue<T>::close() {
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    notEmpty.notify_all();
+    notFull.notify_all();
+}
+
+#endif // BOUNDEDQUEUE_H
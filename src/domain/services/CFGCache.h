@@ -0,0 +1,159 @@
+#ifndef CFGCACHE_H
+#define CFGCACHE_H
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../entities/UGraph.h"
+#include "GraphArena.h"
+#include "GraphSerializer.h"
+#include "HashService.h"
+#include "Metrics.h"
+
+
+/**
+ * @class CFGCache
+ * @brief On-disk cache of built CFGs, one GraphSerializer file per key.
+ *        Keys hash the source bytes together with a salt identifying the grammar and extractor.
+ *        Entries are written to a private temporary file and renamed into place, so concurrent
+ *        readers only ever map complete files.
+ */
+class CFGCache {
+    private:
+        std::filesystem::path directory;
+        std::string salt;
+
+        std::filesystem::path entry(const std::string&) const;
+
+    public:
+        CFGCache(const std::filesystem::path&, const std::string&);
+        ~CFGCache();
+        static std::string readFile(const std::filesystem::path&);
+        std::string key(const std::filesystem::path&) const;
+        UGraph<std::string>* get(const std::string&, GraphArena* = nullptr) const;
+        void put(const std::string&, const UGraph<std::string>&) const;
+};
+
+
+/**
+ * @brief Constructor for the CFGCache class.
+ * @param directory Cache directory, created if missing
+ * @param salt Grammar/extractor identity mixed into every key
+ */
+CFGCache::CFGCache(const std::filesystem::path& directory, const std::string& salt) : directory(directory), salt(salt) {
+    std::filesystem::create_directories(directory);
+}
+
+
+/**
+ * @brief Destructor for the CFGCache class.
+ */
+CFGCache::~CFGCache(){}
+
+
+/**
+ * @brief Read a whole file.
+ * @param file File to read
+ * @throws std::runtime_error if the file cannot be opened.
+ * @return File bytes
+ */
+std::string CFGCache::readFile(const std::filesystem::path& file) {
+    std::ifstream input(file, std::ios::in | std::ios::binary);
+    if (input.fail()) {
+        throw std::runtime_error("CFGCache: cannot open " + file.string());
+    }
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+    return buffer.str();
+}
+
+
+/**
+ * @brief Cache key of a source file.
+ * @param sourceCode File to analyze
+ * @return Hexadecimal digest of salt + source bytes
+ */
+std::string CFGCache::key(const std::filesystem::path& sourceCode) const {
+    return HashService::digest(salt + '\0' + readFile(sourceCode));
+}
+
+
+/**
+ * @brief Path of a cache entry.
+ */
+std::filesystem::path CFGCache::entry(const std::string& key) const {
+    return directory / (key + ".cfg");
+}
+
+
+/**
+ * @brief Load a cached graph by mapping its file.
+ * @param key Key from key()
+ * @param arena Arena that owns the graph, nullptr for a graph owned by the caller
+ * @return New graph, nullptr on a miss or an unreadable entry
+ */
+UGraph<std::string>* CFGCache::get(const std::string& key, GraphArena* arena) const {
+    int fd = open(entry(key).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    Metrics::add(Metrics::BYTES_READ, info.st_size);
+    UGraph<std::string>* graph = nullptr;
+    try {
+        graph = GraphSerializer::deserialize(static_cast<const char*>(data), info.st_size, arena);
+    } catch (const std::exception& e) {
+        graph = nullptr;
+    }
+    munmap(data, info.st_size);
+
+    return graph;
+}
+
+
+/**
+ * @brief Store a graph. Failures are ignored, the cache is only an accelerator.
+ * @param key Key from key()
+ * @param graph Graph to store
+ */
+void CFGCache::put(const std::string& key, const UGraph<std::string>& graph) const {
+    std::stringstream suffix;
+    suffix << ".tmp." << getpid() << "." << std::this_thread::get_id();
+    std::filesystem::path target = entry(key);
+    std::filesystem::path temporary = target.string() + suffix.str();
+
+    std::string data = GraphSerializer::serialize(graph);
+    std::ofstream output(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    output.write(data.data(), data.size());
+    output.close();
+
+    std::error_code error;
+    if (output.fail()) {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+#endif // CFGCACHE_H
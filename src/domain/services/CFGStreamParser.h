@@ -0,0 +1,234 @@
+#ifndef CFGSTREAMPARSER_H
+#define CFGSTREAMPARSER_H
+
+#include <stdexcept>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../entities/UGraph.h"
+#include "GraphSerializer.h"
+
+
+/**
+ * @class CFGStreamParser
+ * @brief Incremental parser for the "Nodes in CFG" / "Edges in CFG" text printed by tools/AST.py.
+ *        Bytes are fed as they arrive and vertexes/edges are inserted straight into a UGraph.
+ *        When the output starts with a "Methods in CFG" section, the sub-CFG of every method
+ *        is also kept apart (getMethods).
+ *        Output that starts with the GraphSerializer magic (tools/AST.py --binary) is buffered
+ *        instead and loaded into the graph in one pass when it is complete.
+ */
+class CFGStreamParser {
+    public:
+        struct Method {
+            std::string hash;
+            std::string name;
+            bool cached = false;
+            std::vector<std::string> labels;
+            std::vector<std::pair<int, int>> edges;
+            int entry = -1;
+        };
+
+    private:
+        enum class Section { HEADER, METHODS, NODES, EDGES, BINARY };
+
+        Section section;
+        bool detected;
+        std::string pending;
+        std::unordered_map<std::string, int> ids;
+        std::vector<std::pair<int, std::string>> vertexes;
+        std::vector<std::pair<int, int>> owners;
+        std::unordered_map<std::string, int> methodIds;
+        std::vector<Method> methods;
+        UGraph<std::string>* graph;
+
+        void parseLines(const char*, size_t);
+        void parseLine(const char*, size_t);
+
+    public:
+        CFGStreamParser(UGraph<std::string>*);
+        ~CFGStreamParser();
+        void feed(const char*, size_t);
+        void finish();
+        std::vector<Method>& getMethods();
+};
+
+
+/**
+ * @brief Constructor for the CFGStreamParser class.
+ * @param graph Graph that receives the parsed edges, nullptr to only keep the methods
+ */
+CFGStreamParser::CFGStreamParser(UGraph<std::string>* graph) : section(Section::HEADER), detected(false), graph(graph) {}
+
+
+/**
+ * @brief Destructor for the CFGStreamParser class.
+ */
+CFGStreamParser::~CFGStreamParser(){}
+
+
+/**
+ * @brief Consume a chunk of extractor output. Incomplete lines are kept until the next chunk.
+ *        The first bytes decide between the text and the binary format.
+ * @param data Chunk start
+ * @param size Chunk length
+ * @throws std::runtime_error if binary output arrives for a parser without a graph.
+ */
+void CFGStreamParser::feed(const char* data, size_t size) {
+    if (section == Section::BINARY) {
+        pending.append(data, size);
+        return;
+    }
+    if (detected) {
+        parseLines(data, size);
+        return;
+    }
+
+    // Too early to tell: hold the bytes until the magic number can be compared
+    pending.append(data, size);
+    if (pending.size() < sizeof(uint32_t)) {
+        return;
+    }
+    detected = true;
+    if (GraphSerializer::isSerialized(pending.data(), pending.size())) {
+        if (!graph) {
+            throw std::runtime_error("CFGStreamParser: binary output carries no methods");
+        }
+        section = Section::BINARY;
+        return;
+    }
+    std::string head;
+    head.swap(pending);
+    parseLines(head.data(), head.size());
+}
+
+
+/**
+ * @brief Split a chunk of text output into lines.
+ * @param data Chunk start
+ * @param size Chunk length
+ */
+void CFGStreamParser::parseLines(const char* data, size_t size) {
+    const char* end = data + size;
+
+    while (data < end) {
+        const char* newline = static_cast<const char*>(memchr(data, '\n', end - data));
+        if (!newline) {
+            pending.append(data, end - data);
+            return;
+        }
+
+        if (pending.empty()) {
+            parseLine(data, newline - data);
+        } else {
+            pending.append(data, newline - data);
+            parseLine(pending.data(), pending.size());
+            pending.clear();
+        }
+        data = newline + 1;
+    }
+}
+
+
+/**
+ * @brief Flush the last line when the output does not end with a newline,
+ *        or load the whole graph when the output was binary.
+ * @throws std::runtime_error if the binary output is not a valid serialized graph.
+ */
+void CFGStreamParser::finish() {
+    if (section == Section::BINARY) {
+        GraphSerializer::deserialize(pending.data(), pending.size(), *graph);
+        pending.clear();
+    } else if (!pending.empty()) {
+        parseLine(pending.data(), pending.size());
+        pending.clear();
+    }
+}
+
+
+/**
+ * @brief Methods listed in the output, each with its own sub-CFG (local vertex ids, entry
+ *        vertex). Methods marked cached have no vertexes: the extractor skipped them.
+ */
+std::vector<CFGStreamParser::Method>& CFGStreamParser::getMethods() {
+    return methods;
+}
+
+
+/**
+ * @brief Parse one line of output. Node ids are renumbered in order of appearance,
+ *        so "root" becomes vertex 0.
+ * @param line Line start (without the newline)
+ * @param size Line length
+ * @throws std::runtime_error if an edge references an unknown node.
+ */
+void CFGStreamParser::parseLine(const char* line, size_t size) {
+    if (size && line[size - 1] == '\r') size--;
+    if (size == 0) return;
+
+    if (line[0] == 'M' && std::string(line, size) == "Methods in CFG:") {
+        section = Section::METHODS;
+        return;
+    }
+    if (line[0] == 'N' && std::string(line, size) == "Nodes in CFG:") {
+        section = Section::NODES;
+        return;
+    }
+    if (line[0] == 'E' && std::string(line, size) == "Edges in CFG:") {
+        section = Section::EDGES;
+        return;
+    }
+
+    const char* space = static_cast<const char*>(memchr(line, ' ', size));
+    size_t keySize = space ? space - line : size;
+    std::string key(line, keySize);
+    const char* rest = space ? space + 1 : line + size;
+    size_t restSize = line + size - rest;
+
+    if (section == Section::METHODS) {
+        Method method;
+        method.hash = key;
+        method.name = std::string(rest, restSize);
+        const std::string CACHED = " cached";
+        if (method.name.size() > CACHED.size() && method.name.compare(method.name.size() - CACHED.size(), CACHED.size(), CACHED) == 0) {
+            method.name.resize(method.name.size() - CACHED.size());
+            method.cached = true;
+        }
+        methodIds[method.name] = methods.size();
+        methods.push_back(std::move(method));
+    } else if (section == Section::NODES) {
+        int id = vertexes.size();
+        ids[key] = id;
+        vertexes.push_back(std::make_pair(id, std::string(rest, restSize)));
+
+        // Method nodes are named "<method>_<n>"
+        std::pair<int, int> owner(-1, -1);
+        size_t separator = key.rfind('_');
+        auto method = separator == std::string::npos ? methodIds.end() : methodIds.find(key.substr(0, separator));
+        if (method != methodIds.end()) {
+            owner = std::make_pair(method->second, (int) methods[method->second].labels.size());
+            methods[method->second].labels.push_back(vertexes.back().second);
+        }
+        owners.push_back(owner);
+    } else if (section == Section::EDGES) {
+        auto from = ids.find(key);
+        auto to = ids.find(std::string(rest, restSize));
+        if (from == ids.end() || to == ids.end()) {
+            throw std::runtime_error("CFGStreamParser: edge references unknown node");
+        }
+        if (graph) {
+            graph->addEdge(vertexes[from->second], vertexes[to->second]);
+        }
+
+        const std::pair<int, int>& source = owners[from->second];
+        const std::pair<int, int>& target = owners[to->second];
+        if (target.first >= 0 && source.first == target.first) {
+            methods[target.first].edges.push_back(std::make_pair(source.second, target.second));
+        } else if (target.first >= 0 && source.first < 0) {
+            methods[target.first].entry = target.second;
+        }
+    }
+}
+
+#endif // CFGSTREAMPARSER_H
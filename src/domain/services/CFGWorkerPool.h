@@ -0,0 +1,293 @@
+#ifndef CFGWORKERPOOL_H
+#define CFGWORKERPOOL_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include "../entities/ExtractionBudget.h"
+#include "Metrics.h"
+#include "ProcessWatchdog.h"
+
+extern char** environ;
+
+
+/**
+ * @class CFGWorkerPool
+ * @brief Pool of resident extractor processes (tools/AST.py --worker) reached over pipes.
+ *        Requests are framed as a 4-byte big-endian length + file path; responses as a
+ *        status byte + 4-byte big-endian length + payload.
+ *        With a budget, a worker that goes over it on a request is killed (and restarted on
+ *        its next request), and the request fails.
+ *        The same framing drives shard workers (ShardService), whose requests are tiles.
+ *        The program must ignore SIGPIPE (see main), so that a worker dying mid-request
+ *        fails the request instead of killing the caller.
+ */
+class CFGWorkerPool {
+    private:
+        struct Worker {
+            pid_t pid = -1;
+            int requests = -1;
+            int responses = -1;
+            int inFlight = 0;
+            std::mutex lock;
+        };
+
+        const static size_t CHUNK_SIZE;
+
+        std::vector<std::string> command;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::mutex dispatch;
+        ExtractionBudget budget;
+
+        void spawn(Worker&);
+        void stop(Worker&);
+        static void writeAll(int, const char*, size_t);
+        static bool readAll(int, char*, size_t, ProcessWatchdog&);
+
+    public:
+        CFGWorkerPool(const std::vector<std::string>&, size_t);
+        ~CFGWorkerPool();
+        CFGWorkerPool(const CFGWorkerPool&) = delete;
+        CFGWorkerPool& operator=(const CFGWorkerPool&) = delete;
+        size_t size() const;
+        void setBudget(const ExtractionBudget&);
+        void request(const std::string&, const std::function<void(const char*, size_t)>&);
+};
+
+
+/**
+ * @brief Constructor for the CFGWorkerPool class. Starts every worker up front.
+ * @param command Worker argv, e.g. {"python3", "tools/AST.py", "java", "java.so", "--worker"}
+ * @param size Number of resident workers
+ * @throws std::runtime_error if a worker cannot be started.
+ */
+CFGWorkerPool::CFGWorkerPool(const std::vector<std::string>& command, size_t size) : command(command) {
+    for (size_t i = 0; i < std::max<size_t>(size, 1); i++) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        spawn(*workers.back());
+    }
+}
+
+
+/**
+ * @brief Destructor for the CFGWorkerPool class. Closing stdin makes each worker exit.
+ */
+CFGWorkerPool::~CFGWorkerPool() {
+    for (auto& worker : workers) {
+        stop(*worker);
+    }
+}
+
+
+/**
+ * @brief Number of resident workers.
+ * @return Pool size
+ */
+size_t CFGWorkerPool::size() const {
+    return workers.size();
+}
+
+
+/**
+ * @brief Limit every later request (see ProcessWatchdog). The CPU budget counts the CPU
+ *        time used during the request; the memory budget is the worker's whole RSS.
+ * @param limits Per-request budget, unlimited by default
+ */
+void CFGWorkerPool::setBudget(const ExtractionBudget& limits) {
+    std::lock_guard<std::mutex> guard(dispatch);
+    budget = limits;
+}
+
+
+/**
+ * @brief Start a worker process with its stdin/stdout connected to pipes.
+ * @param worker Worker slot to fill
+ * @throws std::runtime_error if the process cannot be started.
+ */
+void CFGWorkerPool::spawn(Worker& worker) {
+    Metrics::Timer timer(Metrics::SPAWN);
+    // Close-on-exec keeps other workers from holding this worker's stdin open
+    int toWorker[2], fromWorker[2];
+    if (pipe2(toWorker, O_CLOEXEC) != 0) {
+        throw std::runtime_error("CFGWorkerPool: cannot open pipe");
+    }
+    if (pipe2(fromWorker, O_CLOEXEC) != 0) {
+        close(toWorker[0]);
+        close(toWorker[1]);
+        throw std::runtime_error("CFGWorkerPool: cannot open pipe");
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, toWorker[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fromWorker[1], STDOUT_FILENO);
+
+    std::vector<char*> argv;
+    for (std::string& arg : command) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int status = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(toWorker[0]);
+    close(fromWorker[1]);
+
+    if (status != 0) {
+        close(toWorker[1]);
+        close(fromWorker[0]);
+        throw std::runtime_error("CFGWorkerPool: cannot start " + command[0]);
+    }
+
+    worker.pid = pid;
+    worker.requests = toWorker[1];
+    worker.responses = fromWorker[0];
+}
+
+
+/**
+ * @brief Close a worker's pipes and reap the process.
+ * @param worker Worker to stop
+ */
+void CFGWorkerPool::stop(Worker& worker) {
+    if (worker.requests >= 0) close(worker.requests);
+    if (worker.responses >= 0) close(worker.responses);
+    if (worker.pid > 0) waitpid(worker.pid, nullptr, 0);
+
+    worker.pid = -1;
+    worker.requests = -1;
+    worker.responses = -1;
+}
+
+
+/**
+ * @brief Write a whole buffer to a pipe.
+ * @throws std::runtime_error if the worker closed its end.
+ */
+void CFGWorkerPool::writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t bytes = write(fd, data, size);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("CFGWorkerPool: cannot write to worker");
+        }
+        data += bytes;
+        size -= bytes;
+    }
+}
+
+
+/**
+ * @brief Read exactly `size` bytes from a pipe.
+ * @throws std::runtime_error if the worker goes over budget meanwhile.
+ * @return False if the worker closed its end first
+ */
+bool CFGWorkerPool::readAll(int fd, char* data, size_t size, ProcessWatchdog& watchdog) {
+    while (size > 0) {
+        watchdog.wait(fd);
+        ssize_t bytes = read(fd, data, size);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) return false;
+        data += bytes;
+        size -= bytes;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Extract a file's CFG on the least-loaded worker and stream the response payload.
+ *        A worker that dies is restarted before the error is reported.
+ * @param file Path of the source file, as seen by the worker (or a NUL byte and the source itself)
+ * @param consumer Called with every chunk of the "Nodes in CFG" / "Edges in CFG" text
+ * @throws std::runtime_error if the worker fails or reports an extraction error.
+ */
+void CFGWorkerPool::request(const std::string& file, const std::function<void(const char*, size_t)>& consumer) {
+    Worker* worker;
+    ExtractionBudget limits;
+    {
+        std::lock_guard<std::mutex> guard(dispatch);
+        limits = budget;
+        worker = workers.front().get();
+        for (auto& candidate : workers) {
+            if (candidate->inFlight < worker->inFlight) {
+                worker = candidate.get();
+            }
+        }
+        worker->inFlight++;
+    }
+
+    auto release = [this, worker]() {
+        std::lock_guard<std::mutex> guard(dispatch);
+        worker->inFlight--;
+    };
+
+    std::unique_lock<std::mutex> busy(worker->lock);
+    std::string error;
+    unsigned char header[5];
+
+    try {
+        if (worker->pid < 0) {
+            spawn(*worker);
+        }
+
+        uint32_t size = file.size();
+        for (int i = 0; i < 4; i++) {
+            header[i] = (size >> (24 - 8 * i)) & 0xFF;
+        }
+        writeAll(worker->requests, reinterpret_cast<const char*>(header), 4);
+        writeAll(worker->requests, file.data(), file.size());
+
+        ProcessWatchdog watchdog(worker->pid, limits);
+        if (!readAll(worker->responses, reinterpret_cast<char*>(header), 5, watchdog)) {
+            throw std::runtime_error("CFGWorkerPool: worker exited");
+        }
+
+        size = 0;
+        for (int i = 1; i < 5; i++) {
+            size = (size << 8) | header[i];
+        }
+
+        std::string buffer(std::min<size_t>(size, CHUNK_SIZE), '\0');
+        while (size > 0) {
+            size_t chunk = std::min<size_t>(size, buffer.size());
+            if (!readAll(worker->responses, &buffer[0], chunk, watchdog)) {
+                throw std::runtime_error("CFGWorkerPool: worker exited");
+            }
+            Metrics::add(Metrics::BYTES_READ, chunk);
+            if (header[0] == 0) {
+                consumer(buffer.data(), chunk);
+            } else {
+                error.append(buffer.data(), chunk);
+            }
+            size -= chunk;
+        }
+    } catch (...) {
+        // The protocol state is unknown, restart the worker on its next request
+        stop(*worker);
+        busy.unlock();
+        release();
+        throw;
+    }
+
+    busy.unlock();
+    release();
+
+    if (header[0] != 0) {
+        throw std::runtime_error("CFGWorkerPool: " + error);
+    }
+}
+
+const size_t CFGWorkerPool::CHUNK_SIZE = 1 << 16;
+
+#endif // CFGWORKERPOOL_H
@@ -3,10 +3,20 @@
 
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
+#include <functional>
+#include <cerrno>
+#include <csignal>
 #include <stdio.h>
-#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/wait.h>
 #include <string>
+#include "../entities/ExtractionBudget.h"
+#include "Metrics.h"
+#include "ProcessWatchdog.h"
+
+extern char** environ;
 
 
 /**
@@ -15,12 +25,13 @@
  */
 class CommandExecutor {
     private:
-        const static std::filesystem::path TEMP_DIR;
-    
+        const static size_t CHUNK_SIZE;
+
     public:
         CommandExecutor();
         ~CommandExecutor();
         static std::string execute(std::string&);
+        static void stream(std::string&, const std::function<void(const char*, size_t)>&, const ExtractionBudget& = ExtractionBudget());
 };
 
 
@@ -37,36 +48,95 @@ CommandExecutor::~CommandExecutor(){}
 
 
 /**
- * @brief Executes a system command and returns the output file path.
- * @param command The command to be executed. 
+ * @brief Executes a system command and returns its output.
+ * @param command The command to be executed.
  * @throws std::runtime_error if the command cannot be executed.
- * @return Generates a file with the output of the command and returns its path.
+ * @return Everything the command wrote to stdout
  */
 std::string CommandExecutor::execute(std::string& command) {
-   char buffer[128];
     std::string result = "";
-    
-    std::FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
+
+    stream(command, [&result](const char* data, size_t size) {
+        result.append(data, size);
+    });
+
+    return result;
+}
+
+
+/**
+ * @brief Executes a system command and hands its stdout to a consumer as it arrives.
+ *        The command runs as `/bin/sh -c "exec <command>"` in its own process group, so a
+ *        watchdog can measure and kill the program itself.
+ * @param command The command to be executed.
+ * @param consumer Called with every chunk read from the pipe
+ * @param budget Limits of the command, enforced while it runs (see ProcessWatchdog)
+ * @throws std::runtime_error if the command cannot be executed, exits with an error or goes over budget.
+ */
+void CommandExecutor::stream(std::string& command, const std::function<void(const char*, size_t)>& consumer, const ExtractionBudget& budget) {
+    int output[2];
+    if (pipe2(output, O_CLOEXEC) != 0) {
         throw std::runtime_error("CommandExecutor: cannot open pipe");
     }
 
-    while (fgets(buffer, sizeof(buffer), pipe) != NULL) {
-        result += buffer;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    std::string shell = "/bin/sh", flag = "-c", script = "exec " + command;
+    char* argv[] = {&shell[0], &flag[0], &script[0], nullptr};
+    pid_t pid;
+    int status;
+    {
+        Metrics::Timer timer(Metrics::SPAWN);
+        status = posix_spawn(&pid, argv[0], &actions, &attributes, argv, environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(output[1]);
+    if (status != 0) {
+        close(output[0]);
+        throw std::runtime_error("CommandExecutor: cannot start " + command);
     }
 
-    pclose(pipe);
-
-    std::filesystem::path outputLocation = TEMP_DIR / "output.txt";
-    std::ofstream output;
-
-    output.open(outputLocation.c_str(), std::ios::out);
-    output << result;
-    output.close();
+    std::string buffer(CHUNK_SIZE, '\0');
+    ProcessWatchdog watchdog(pid, budget);
+    ssize_t bytes;
+
+    try {
+        while (true) {
+            watchdog.wait(output[0]);
+            bytes = read(output[0], &buffer[0], buffer.size());
+            if (bytes == 0) break;
+            if (bytes < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("CommandExecutor: cannot read pipe");
+            }
+            Metrics::add(Metrics::BYTES_READ, bytes);
+            consumer(buffer.data(), bytes);
+        }
+    } catch (...) {
+        // Nothing reads the rest of the output: stop the command rather than wait for it
+        close(output[0]);
+        ::kill(-pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        throw;
+    }
 
-    return outputLocation.string();
+    close(output[0]);
+    pid_t exited;
+    do {
+        exited = waitpid(pid, &status, 0);
+    } while (exited < 0 && errno == EINTR);
+    if (exited < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("CommandExecutor: command failed: " + command);
+    }
 }
 
-const std::filesystem::path CommandExecutor::TEMP_DIR = std::filesystem::temp_directory_path();
+const size_t CommandExecutor::CHUNK_SIZE = 1 << 16;
 
-#endif // COMMANDEXECUTOR_H
\ No newline at end of file
+#endif // COMMANDEXECUTOR_H
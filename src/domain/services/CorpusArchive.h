@@ -0,0 +1,298 @@
+#ifndef CORPUSARCHIVE_H
+#define CORPUSARCHIVE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * @class CorpusArchive
+ * @brief A whole corpus packed into one memory-mapped file, so a dataset of thousands of
+ *        small files is read without walking directories or opening each file.
+ *        Layout: the 4 bytes "CARC", then in host byte order version, file count, salt length (uint32 each),
+ *        the salt padded to 8 bytes, one entry per file (uint64 offsets of its path, source
+ *        and serialized CFG, then their uint32 lengths and a reserved uint32), and the
+ *        paths, sources and CFGs back to back. Entries are sorted by path.
+ *        The salt identifies the extractor that built the CFGs (CFGBuilderService::cacheSalt);
+ *        an archive without CFGs has an empty salt.
+ */
+class CorpusArchive {
+    public:
+        struct File {
+            std::string_view path;
+            std::string_view source;
+            std::string_view cfg;
+        };
+
+    private:
+        struct Entry {
+            uint64_t pathOffset;
+            uint64_t sourceOffset;
+            uint64_t cfgOffset;
+            uint32_t pathLength;
+            uint32_t sourceLength;
+            uint32_t cfgLength;
+            uint32_t reserved;
+        };
+
+        const static char MAGIC[4];
+        const static uint32_t VERSION;
+
+        const char* data;
+        size_t length;
+        std::string_view salt;
+        const Entry* entries;
+        uint32_t count;
+
+        static size_t tableOffset(size_t);
+
+    public:
+        CorpusArchive(const std::filesystem::path&);
+        ~CorpusArchive();
+        CorpusArchive(const CorpusArchive&) = delete;
+        CorpusArchive& operator=(const CorpusArchive&) = delete;
+        static size_t pack(const std::filesystem::path&, const std::filesystem::path&, const std::string& = "", const std::function<std::string(const std::filesystem::path&)>& = nullptr, size_t = 0);
+        size_t size() const;
+        File get(size_t) const;
+        size_t find(std::string_view) const;
+        std::string_view getSalt() const;
+};
+
+
+/**
+ * @brief Map an archive and check its file table.
+ * @param archive Archive written by pack
+ * @throws std::runtime_error if the file cannot be mapped or is not a valid archive.
+ */
+CorpusArchive::CorpusArchive(const std::filesystem::path& archive) : data(nullptr), length(0), entries(nullptr), count(0) {
+    int fd = open(archive.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("CorpusArchive: cannot open " + archive.string());
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t) (sizeof(MAGIC) + 3 * sizeof(uint32_t))) {
+        close(fd);
+        throw std::runtime_error("CorpusArchive: not an archive " + archive.string());
+    }
+
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("CorpusArchive: cannot map " + archive.string());
+    }
+    data = static_cast<const char*>(mapping);
+    length = info.st_size;
+
+    // Validate every entry once, so get() can hand out views without checks
+    uint32_t header[3];
+    memcpy(header, data + sizeof(MAGIC), sizeof(header));
+    bool valid = memcmp(data, MAGIC, sizeof(MAGIC)) == 0 && header[0] == VERSION;
+    size_t table = tableOffset(header[2]);
+    valid = valid && table + (size_t) header[1] * sizeof(Entry) <= length;
+    if (valid) {
+        count = header[1];
+        salt = std::string_view(data + sizeof(MAGIC) + sizeof(header), header[2]);
+        entries = reinterpret_cast<const Entry*>(data + table);
+        for (uint32_t i = 0; i < count && valid; i++) {
+            const Entry& entry = entries[i];
+            valid = entry.pathOffset <= length && entry.pathLength <= length - entry.pathOffset
+                 && entry.sourceOffset <= length && entry.sourceLength <= length - entry.sourceOffset
+                 && entry.cfgOffset <= length && entry.cfgLength <= length - entry.cfgOffset
+                 && (i == 0 || get(i - 1).path < get(i).path);
+        }
+    }
+    if (!valid) {
+        munmap(mapping, length);
+        throw std::runtime_error("CorpusArchive: not an archive " + archive.string());
+    }
+}
+
+
+/**
+ * @brief Destructor for the CorpusArchive class. Unmaps the archive.
+ */
+CorpusArchive::~CorpusArchive(){
+    if (data) {
+        munmap(const_cast<char*>(data), length);
+    }
+}
+
+
+/**
+ * @brief Offset of the file table: after the header and the salt, aligned to 8 bytes.
+ */
+size_t CorpusArchive::tableOffset(size_t saltLength) {
+    return (sizeof(MAGIC) + 3 * sizeof(uint32_t) + saltLength + 7) & ~(size_t) 7;
+}
+
+
+/**
+ * @brief Pack every .java file below a directory into an archive. The archive is written
+ *        to a temporary file and renamed into place.
+ * @param directory Corpus root; archived paths are relative to it
+ * @param archive Archive to write
+ * @param salt Identity of the extractor behind getCFG
+ * @param getCFG Serialized CFG of a file (GraphSerializer), empty if it cannot be built;
+ *               nullptr to archive sources only. Called from several threads.
+ * @param threads Threads calling getCFG, 0 for one per core
+ * @throws std::runtime_error if the directory cannot be read or the archive cannot be written.
+ * @return Number of files archived
+ */
+size_t CorpusArchive::pack(const std::filesystem::path& directory, const std::filesystem::path& archive, const std::string& salt, const std::function<std::string(const std::filesystem::path&)>& getCFG, size_t threads) {
+    std::vector<std::filesystem::path> files;
+    for (const auto & file : std::filesystem::recursive_directory_iterator(directory)) {
+        if (file.is_regular_file() && file.path().extension() == ".java") {
+            files.push_back(file.path());
+        }
+    }
+    std::vector<std::string> paths;
+    for (const std::filesystem::path& file : files) {
+        paths.push_back(std::filesystem::relative(file, directory).generic_string());
+    }
+    std::vector<size_t> order(files.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&paths](size_t a, size_t b) {
+        return paths[a] < paths[b];
+    });
+
+    std::vector<std::string> cfgs(files.size());
+    if (getCFG) {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t t = 0; t < std::min(threads, files.size()); t++) {
+            workers.emplace_back([&]() {
+                for (size_t i = next++; i < files.size(); i = next++) {
+                    cfgs[i] = getCFG(files[i]);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    std::stringstream suffix;
+    suffix << ".tmp." << getpid();
+    std::filesystem::path temporary = archive.string() + suffix.str();
+    std::ofstream output(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    std::vector<Entry> table(files.size());
+    uint32_t header[3] = {VERSION, (uint32_t) files.size(), (uint32_t) salt.size()};
+    uint64_t offset = tableOffset(salt.size()) + table.size() * sizeof(Entry);
+
+    // Table placeholder first: the offsets are only known once the sources are read
+    output.write(MAGIC, sizeof(MAGIC));
+    output.write(reinterpret_cast<const char*>(header), sizeof(header));
+    output.write(salt.data(), salt.size());
+    output.write("\0\0\0\0\0\0\0", tableOffset(salt.size()) - sizeof(MAGIC) - sizeof(header) - salt.size());
+    output.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+
+    for (size_t i = 0; i < order.size(); i++) {
+        table[i].pathOffset = offset;
+        table[i].pathLength = paths[order[i]].size();
+        output.write(paths[order[i]].data(), paths[order[i]].size());
+        offset += paths[order[i]].size();
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        std::ifstream input(files[order[i]], std::ios::in | std::ios::binary);
+        if (!input.is_open()) {
+            output.close();
+            std::filesystem::remove(temporary);
+            throw std::runtime_error("CorpusArchive: cannot read " + files[order[i]].string());
+        }
+        std::stringstream buffer;
+        buffer << input.rdbuf();
+        std::string source = buffer.str();
+        table[i].sourceOffset = offset;
+        table[i].sourceLength = source.size();
+        output.write(source.data(), source.size());
+        offset += source.size();
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        table[i].cfgOffset = offset;
+        table[i].cfgLength = cfgs[order[i]].size();
+        output.write(cfgs[order[i]].data(), cfgs[order[i]].size());
+        offset += cfgs[order[i]].size();
+    }
+
+    output.seekp(tableOffset(salt.size()));
+    output.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+    output.close();
+    if (output.fail()) {
+        std::filesystem::remove(temporary);
+        throw std::runtime_error("CorpusArchive: cannot write " + archive.string());
+    }
+    std::filesystem::rename(temporary, archive);
+    return files.size();
+}
+
+
+/**
+ * @brief Number of archived files.
+ */
+size_t CorpusArchive::size() const {
+    return count;
+}
+
+
+/**
+ * @brief An archived file. The views point into the mapping and live as long as the archive.
+ * @param index File index, in path order
+ * @return Relative path, source bytes and serialized CFG (empty if none was archived)
+ */
+CorpusArchive::File CorpusArchive::get(size_t index) const {
+    const Entry& entry = entries[index];
+    return File{
+        std::string_view(data + entry.pathOffset, entry.pathLength),
+        std::string_view(data + entry.sourceOffset, entry.sourceLength),
+        std::string_view(data + entry.cfgOffset, entry.cfgLength)
+    };
+}
+
+
+/**
+ * @brief Look up a file by its archived path.
+ * @param path Path relative to the packed directory, with '/' separators
+ * @return File index, size_t(-1) if the file is not archived
+ */
+size_t CorpusArchive::find(std::string_view path) const {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (get(middle).path < path) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < count && get(low).path == path ? low : (size_t) -1;
+}
+
+
+/**
+ * @brief Identity of the extractor that built the archived CFGs, empty if there are none.
+ */
+std::string_view CorpusArchive::getSalt() const {
+    return salt;
+}
+
+const char CorpusArchive::MAGIC[4] = {'C', 'A', 'R', 'C'};
+const uint32_t CorpusArchive::VERSION = 1;
+
+#endif // CORPUSARCHIVE_H
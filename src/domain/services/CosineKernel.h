@@ -0,0 +1,229 @@
+#ifndef COSINEKERNEL_H
+#define COSINEKERNEL_H
+
+#include <cmath>
+#include <cstddef>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COSINE_KERNEL_X86
+#endif
+
+
+/**
+ * @class CosineKernel
+ * @brief Fused single-pass cosine over two dense vectors: dot product and both squared
+ *        magnitudes are accumulated together, in double precision, whatever the storage type.
+ *        SSE2, AVX2 and AVX-512 variants are compiled with per-function target attributes and
+ *        picked at runtime from the CPU's features; other CPUs use the scalar loop.
+ */
+class CosineKernel {
+    public:
+        enum class Variant { SCALAR, SSE2, AVX2, AVX512 };
+
+        struct Sums {
+            double dot = 0.0;
+            double norm1 = 0.0;
+            double norm2 = 0.0;
+        };
+
+        static Variant best();
+        static bool supported(Variant);
+        static const char* name(Variant);
+        template<class Real>
+        static Sums sums(const Real*, const Real*, size_t, Variant);
+        template<class Real>
+        static double cosine(const Real*, const Real*, size_t, Variant = best());
+
+    private:
+        template<class Real>
+        static Sums scalar(const Real*, const Real*, size_t);
+#ifdef COSINE_KERNEL_X86
+        template<class Real>
+        static Sums sse2(const Real*, const Real*, size_t);
+        template<class Real>
+        static Sums avx2(const Real*, const Real*, size_t);
+        template<class Real>
+        static Sums avx512(const Real*, const Real*, size_t);
+#endif
+};
+
+
+/**
+ * @brief Fastest variant this CPU supports, detected once.
+ */
+CosineKernel::Variant CosineKernel::best() {
+    static const Variant variant = []() {
+        if (supported(Variant::AVX512)) return Variant::AVX512;
+        if (supported(Variant::AVX2)) return Variant::AVX2;
+        if (supported(Variant::SSE2)) return Variant::SSE2;
+        return Variant::SCALAR;
+    }();
+    return variant;
+}
+
+
+/**
+ * @brief Whether this CPU can run a variant.
+ */
+bool CosineKernel::supported(Variant variant) {
+#ifdef COSINE_KERNEL_X86
+    __builtin_cpu_init();
+    switch (variant) {
+        case Variant::AVX512: return __builtin_cpu_supports("avx512f");
+        case Variant::AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case Variant::SSE2: return __builtin_cpu_supports("sse2");
+        default: return true;
+    }
+#else
+    return variant == Variant::SCALAR;
+#endif
+}
+
+
+/**
+ * @brief Printable name of a variant.
+ */
+const char* CosineKernel::name(Variant variant) {
+    switch (variant) {
+        case Variant::AVX512: return "avx512";
+        case Variant::AVX2: return "avx2";
+        case Variant::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+
+/**
+ * @brief Dot product and squared magnitudes of two vectors.
+ * @param a 1st vector
+ * @param b 2nd vector
+ * @param size Number of elements of each vector
+ * @param variant Implementation to use (must be supported)
+ * @return The three sums
+ */
+template<class Real>
+CosineKernel::Sums CosineKernel::sums(const Real* a, const Real* b, size_t size, Variant variant) {
+#ifdef COSINE_KERNEL_X86
+    switch (variant) {
+        case Variant::AVX512: return avx512(a, b, size);
+        case Variant::AVX2: return avx2(a, b, size);
+        case Variant::SSE2: return sse2(a, b, size);
+        default: break;
+    }
+#endif
+    return scalar(a, b, size);
+}
+
+
+/**
+ * @brief Cosine between two vectors.
+ * @return Similarity between 0 and 1 (0 if either vector is zero)
+ */
+template<class Real>
+double CosineKernel::cosine(const Real* a, const Real* b, size_t size, Variant variant) {
+    Sums total = sums(a, b, size, variant);
+    if (!total.norm1 || !total.norm2)
+        return 0.0;
+    return total.dot / (sqrt(total.norm1) * sqrt(total.norm2));
+}
+
+
+/**
+ * @brief Portable loop.
+ */
+template<class Real>
+CosineKernel::Sums CosineKernel::scalar(const Real* a, const Real* b, size_t size) {
+    Sums total;
+    for (size_t i = 0; i < size; i++) {
+        double x = a[i], y = b[i];
+        total.dot += x * y;
+        total.norm1 += x * x;
+        total.norm2 += y * y;
+    }
+    return total;
+}
+
+#ifdef COSINE_KERNEL_X86
+
+__attribute__((target("sse2"))) static inline __m128d cosineLoad2(const double* p) { return _mm_loadu_pd(p); }
+__attribute__((target("sse2"))) static inline __m128d cosineLoad2(const float* p) { return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p)))); }
+__attribute__((target("avx2"))) static inline __m256d cosineLoad4(const double* p) { return _mm256_loadu_pd(p); }
+__attribute__((target("avx2"))) static inline __m256d cosineLoad4(const float* p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+__attribute__((target("avx512f"))) static inline __m512d cosineLoad8(const double* p) { return _mm512_loadu_pd(p); }
+__attribute__((target("avx512f"))) static inline __m512d cosineLoad8(const float* p) { return _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(p)); }
+
+
+/**
+ * @brief Two doubles per step.
+ */
+template<class Real>
+__attribute__((target("sse2")))
+CosineKernel::Sums CosineKernel::sse2(const Real* a, const Real* b, size_t size) {
+    __m128d dot = _mm_setzero_pd(), norm1 = _mm_setzero_pd(), norm2 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= size; i += 2) {
+        __m128d x = cosineLoad2(a + i), y = cosineLoad2(b + i);
+        dot = _mm_add_pd(dot, _mm_mul_pd(x, y));
+        norm1 = _mm_add_pd(norm1, _mm_mul_pd(x, x));
+        norm2 = _mm_add_pd(norm2, _mm_mul_pd(y, y));
+    }
+
+    double lanes[2];
+    Sums total = scalar(a + i, b + i, size - i);
+    _mm_storeu_pd(lanes, dot);   total.dot += lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, norm1); total.norm1 += lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, norm2); total.norm2 += lanes[0] + lanes[1];
+    return total;
+}
+
+
+/**
+ * @brief Four doubles per step with fused multiply-add.
+ */
+template<class Real>
+__attribute__((target("avx2,fma")))
+CosineKernel::Sums CosineKernel::avx2(const Real* a, const Real* b, size_t size) {
+    __m256d dot = _mm256_setzero_pd(), norm1 = _mm256_setzero_pd(), norm2 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m256d x = cosineLoad4(a + i), y = cosineLoad4(b + i);
+        dot = _mm256_fmadd_pd(x, y, dot);
+        norm1 = _mm256_fmadd_pd(x, x, norm1);
+        norm2 = _mm256_fmadd_pd(y, y, norm2);
+    }
+
+    double lanes[4];
+    Sums total = scalar(a + i, b + i, size - i);
+    _mm256_storeu_pd(lanes, dot);   total.dot += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_storeu_pd(lanes, norm1); total.norm1 += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_storeu_pd(lanes, norm2); total.norm2 += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    return total;
+}
+
+
+/**
+ * @brief Eight doubles per step with fused multiply-add.
+ */
+template<class Real>
+__attribute__((target("avx512f")))
+CosineKernel::Sums CosineKernel::avx512(const Real* a, const Real* b, size_t size) {
+    __m512d dot = _mm512_setzero_pd(), norm1 = _mm512_setzero_pd(), norm2 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m512d x = cosineLoad8(a + i), y = cosineLoad8(b + i);
+        dot = _mm512_fmadd_pd(x, y, dot);
+        norm1 = _mm512_fmadd_pd(x, x, norm1);
+        norm2 = _mm512_fmadd_pd(y, y, norm2);
+    }
+
+    double lanes[8];
+    Sums total = scalar(a + i, b + i, size - i);
+    _mm512_storeu_pd(lanes, dot);   for (double lane : lanes) total.dot += lane;
+    _mm512_storeu_pd(lanes, norm1); for (double lane : lanes) total.norm1 += lane;
+    _mm512_storeu_pd(lanes, norm2); for (double lane : lanes) total.norm2 += lane;
+    return total;
+}
+
+#endif // COSINE_KERNEL_X86
+
+#endif // COSINEKERNEL_H
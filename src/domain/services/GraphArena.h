@@ -0,0 +1,107 @@
+#ifndef GRAPHARENA_H
+#define GRAPHARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+#include "../entities/UGraph.h"
+
+
+/**
+ * @class GraphArena
+ * @brief Monotonic memory scope for the graphs of one batch or comparison.
+ *        Graphs created here keep their object, vertex sets, adjacency, labels and transition
+ *        cache in the arena. They are never deleted one by one: release() drops every graph of
+ *        the scope at once, in O(1), and keeps the first block for the next scope so steady-state
+ *        runs stop allocating. Not thread-safe; use one arena per thread.
+ */
+class GraphArena {
+    private:
+        const static size_t INITIAL_SIZE;
+
+        std::vector<std::byte> buffer;
+        std::pmr::monotonic_buffer_resource pool;
+
+    public:
+        GraphArena(size_t = INITIAL_SIZE);
+        GraphArena(const GraphArena&) = delete;
+        GraphArena& operator=(const GraphArena&) = delete;
+        ~GraphArena();
+        std::pmr::memory_resource* resource();
+        UGraph<std::string>* create(bool = true);
+        void release();
+        static UGraph<std::string>* create(GraphArena*, bool = true);
+        static void discard(GraphArena*, UGraph<std::string>*);
+};
+
+
+/**
+ * @brief Constructor for the GraphArena class.
+ * @param size Bytes of the block reused by every scope; larger scopes grow from the heap until release()
+ */
+GraphArena::GraphArena(size_t size) : buffer(size ? size : 1), pool(buffer.data(), buffer.size()) {}
+
+
+/**
+ * @brief Destructor for the GraphArena class. Every graph of the arena becomes invalid.
+ */
+GraphArena::~GraphArena(){}
+
+
+/**
+ * @brief Memory resource of the arena.
+ */
+std::pmr::memory_resource* GraphArena::resource() {
+    return &pool;
+}
+
+
+/**
+ * @brief Create an empty graph owned by the arena.
+ * @param direction Whether edges are directed
+ * @return Graph valid until release(); must not be deleted
+ */
+UGraph<std::string>* GraphArena::create(bool direction) {
+    void* memory = pool.allocate(sizeof(UGraph<std::string>), alignof(UGraph<std::string>));
+    return new (memory) UGraph<std::string>(direction, &pool);
+}
+
+
+/**
+ * @brief Drop every graph of the arena without visiting them.
+ *        Their storage comes only from the arena, so no destructor needs to run.
+ */
+void GraphArena::release() {
+    pool.release();
+}
+
+
+/**
+ * @brief Create a graph in an arena, or on the heap when there is none.
+ * @param arena Arena owning the graph, nullptr for a graph owned (and deleted) by the caller
+ * @param direction Whether edges are directed
+ * @return New graph
+ */
+UGraph<std::string>* GraphArena::create(GraphArena* arena, bool direction) {
+    if (arena) {
+        return arena->create(direction);
+    }
+    return new UGraph<std::string>(direction);
+}
+
+
+/**
+ * @brief Give back a graph from create(arena) that will not be used.
+ *        Heap graphs are deleted; arena graphs wait for the arena's release().
+ */
+void GraphArena::discard(GraphArena* arena, UGraph<std::string>* graph) {
+    if (!arena) {
+        delete graph;
+    }
+}
+
+const size_t GraphArena::INITIAL_SIZE = 1 << 20;
+
+#endif // GRAPHARENA_H
@@ -0,0 +1,209 @@
+#ifndef GRAPHFINGERPRINT_H
+#define GRAPHFINGERPRINT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../entities/CSRGraph.h"
+#include "../entities/TokenDictionary.h"
+#include "HashService.h"
+
+
+/**
+ * @class GraphFingerprint
+ * @brief Weisfeiler-Lehman fingerprint of a frozen CFG. Every vertex starts with the hash of
+ *        its label text and, at each level, is relabeled with the hash of its previous label
+ *        and the sorted labels of its successors. The histogram (label -> vertex count) of each
+ *        level is kept, and the 128-bit fingerprint hashes all of them, so it does not depend on
+ *        vertex ids and is stable across runs.
+ *        Graphs with equal level 1 histograms have the same label -> successor label transitions,
+ *        hence the same TransitionVector: equal fingerprints mean equal similarity scores.
+ */
+class GraphFingerprint {
+    public:
+        typedef std::vector<std::pair<uint64_t, uint32_t>> Histogram;
+
+        /**
+         * @struct Hasher
+         * @brief Hash functor for unordered containers keyed by fingerprint.
+         */
+        struct Hasher {
+            size_t operator()(const GraphFingerprint& fingerprint) const { return fingerprint.low; }
+        };
+
+    private:
+        uint64_t high;
+        uint64_t low;
+        std::vector<Histogram> histograms;
+
+        static Histogram histogram(std::vector<uint64_t>);
+
+    public:
+        GraphFingerprint();
+        GraphFingerprint(const CSRGraph&, size_t = 3, const TokenDictionary& = TokenDictionary::global());
+        ~GraphFingerprint();
+        size_t levels() const;
+        const Histogram& getHistogram(size_t) const;
+        double overlap(const GraphFingerprint&, size_t) const;
+        std::string hex() const;
+        bool operator==(const GraphFingerprint&) const;
+        bool operator!=(const GraphFingerprint&) const;
+};
+
+
+/**
+ * @brief Constructor for the fingerprint of a graph that could not be built (no levels).
+ */
+GraphFingerprint::GraphFingerprint() : high(0), low(0) {}
+
+
+/**
+ * @brief Refine the labels of a graph and hash every level.
+ * @param graph Frozen CFG, normally with normalized labels (SimilarityService::freeze)
+ * @param levels Refinement rounds after the initial labels
+ * @param dictionary Dictionary the graph labels were interned in
+ */
+GraphFingerprint::GraphFingerprint(const CSRGraph& graph, size_t levels, const TokenDictionary& dictionary) : high(0), low(0) {
+    std::vector<uint64_t> labels(graph.vertexCount()), next(graph.vertexCount()), successors;
+    for (uint32_t v = 0; v < graph.vertexCount(); v++) {
+        labels[v] = HashService::hash(dictionary.token(graph.label(v)));
+    }
+    histograms.push_back(histogram(labels));
+
+    for (size_t level = 1; level <= levels; level++) {
+        for (uint32_t v = 0; v < graph.vertexCount(); v++) {
+            successors.clear();
+            for (const uint32_t* it = graph.successorsBegin(v); it != graph.successorsEnd(v); it++) {
+                successors.push_back(labels[*it]);
+            }
+            std::sort(successors.begin(), successors.end());
+
+            uint64_t label = HashService::mix(labels[v] ^ level);
+            for (uint64_t successor : successors) {
+                label = HashService::mix(label ^ successor) + successors.size();
+            }
+            next[v] = label;
+        }
+        labels.swap(next);
+        histograms.push_back(histogram(labels));
+    }
+
+    // Two independently seeded folds of every level make the 128 bits
+    high = HashService::mix(0x243F6A8885A308D3ull ^ graph.vertexCount());
+    low = HashService::mix(0x13198A2E03707344ull ^ graph.edgeCount());
+    for (const Histogram& counts : histograms) {
+        for (const std::pair<uint64_t, uint32_t>& entry : counts) {
+            high = HashService::mix(high ^ entry.first) + entry.second;
+            low = HashService::mix(low + entry.first) ^ entry.second;
+        }
+        high = HashService::mix(high);
+        low = HashService::mix(~low);
+    }
+}
+
+
+/**
+ * @brief Destructor for the GraphFingerprint class.
+ */
+GraphFingerprint::~GraphFingerprint(){}
+
+
+/**
+ * @brief Count the vertexes of each label.
+ * @param labels Label of every vertex
+ * @return (label, vertex count) sorted by label
+ */
+GraphFingerprint::Histogram GraphFingerprint::histogram(std::vector<uint64_t> labels) {
+    Histogram counts;
+    std::sort(labels.begin(), labels.end());
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (i && labels[i] == labels[i - 1]) {
+            counts.back().second++;
+        } else {
+            counts.push_back(std::make_pair(labels[i], 1u));
+        }
+    }
+    return counts;
+}
+
+
+/**
+ * @brief Number of histograms kept: the initial labels plus one per refinement round.
+ */
+size_t GraphFingerprint::levels() const {
+    return histograms.size();
+}
+
+
+/**
+ * @brief Histogram of a refinement level.
+ * @param level 0 for the initial labels, up to levels() - 1
+ * @return (label, vertex count) sorted by label
+ */
+const GraphFingerprint::Histogram& GraphFingerprint::getHistogram(size_t level) const {
+    return histograms.at(level);
+}
+
+
+/**
+ * @brief Weighted Jaccard of the histograms of one level: shared vertexes over all vertexes.
+ *        A cheap pre-filter, not a bound of the Markov cosine.
+ * @param other Fingerprint to compare with
+ * @param level Level compared, clamped to the deepest one both fingerprints have
+ * @return Overlap in [0, 1], 1 if neither graph has vertexes at that level
+ */
+double GraphFingerprint::overlap(const GraphFingerprint& other, size_t level) const {
+    if (histograms.empty() || other.histograms.empty()) {
+        return histograms.empty() && other.histograms.empty() ? 1.0 : 0.0;
+    }
+    level = std::min(level, std::min(histograms.size(), other.histograms.size()) - 1);
+    const Histogram& a = histograms[level];
+    const Histogram& b = other.histograms[level];
+
+    uint64_t shared = 0, total = 0;
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].first < b[j].first) {
+            total += a[i++].second;
+        } else if (b[j].first < a[i].first) {
+            total += b[j++].second;
+        } else {
+            shared += std::min(a[i].second, b[j].second);
+            total += std::max(a[i].second, b[j].second);
+            i++;
+            j++;
+        }
+    }
+    for (; i < a.size(); i++) total += a[i].second;
+    for (; j < b.size(); j++) total += b[j].second;
+
+    return total ? (double) shared / total : 1.0;
+}
+
+
+/**
+ * @brief The 128-bit fingerprint as 32 hexadecimal digits.
+ */
+std::string GraphFingerprint::hex() const {
+    return HashService::hex(high) + HashService::hex(low);
+}
+
+
+/**
+ * @brief Equal 128-bit fingerprints.
+ */
+bool GraphFingerprint::operator==(const GraphFingerprint& other) const {
+    return high == other.high && low == other.low;
+}
+
+
+/**
+ * @brief Different 128-bit fingerprints.
+ */
+bool GraphFingerprint::operator!=(const GraphFingerprint& other) const {
+    return !(*this == other);
+}
+
+#endif // GRAPHFINGERPRINT_H
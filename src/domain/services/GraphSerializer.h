@@ -0,0 +1,202 @@
+#ifndef GRAPHSERIALIZER_H
+#define GRAPHSERIALIZER_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../entities/UGraph.h"
+#include "GraphArena.h"
+
+
+/**
+ * @class GraphSerializer
+ * @brief Compact binary form of a UGraph<std::string>: the 4 bytes "CFGB", then in host
+ *        byte order version, vertex count, label count, edge count (uint32 each),
+ *        the deduplicated label table (uint32 length + bytes), one (int32 id, uint32 label)
+ *        per vertex and one (uint32 from, uint32 to) vertex index pair per edge.
+ *        tools/AST.py --binary writes the same layout, so extractor output loads without
+ *        going through the text parser.
+ */
+class GraphSerializer {
+    private:
+        const static char MAGIC[4];
+        const static uint32_t VERSION;
+
+        static void put(std::string&, uint32_t);
+        static uint32_t get(const char*&, const char*);
+
+    public:
+        static std::string serialize(const UGraph<std::string>&);
+        static bool isSerialized(const char*, size_t);
+        static UGraph<std::string>* deserialize(const char*, size_t, GraphArena* = nullptr);
+        static void deserialize(const char*, size_t, UGraph<std::string>&);
+};
+
+
+/**
+ * @brief Append a uint32 to a buffer.
+ */
+void GraphSerializer::put(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+/**
+ * @brief Read a uint32 and advance.
+ * @throws std::runtime_error if the buffer is too short.
+ */
+uint32_t GraphSerializer::get(const char*& data, const char* end) {
+    uint32_t value;
+    if (end - data < (ptrdiff_t) sizeof(value)) {
+        throw std::runtime_error("GraphSerializer: truncated graph");
+    }
+    memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return value;
+}
+
+
+/**
+ * @brief Serialize a graph.
+ * @param graph Graph to write
+ * @return Binary representation
+ */
+std::string GraphSerializer::serialize(const UGraph<std::string>& graph) {
+    const auto& edges = graph.getEdges();
+    std::unordered_map<std::string_view, uint32_t> labelIds;
+    std::vector<std::string_view> labels;
+    std::unordered_map<int, uint32_t> index;
+    size_t edgeCount = 0;
+
+    for (const auto& vertex : edges) {
+        if (labelIds.emplace(vertex.first.second, labels.size()).second) {
+            labels.push_back(vertex.first.second);
+        }
+        index.emplace(vertex.first.first, index.size());
+        edgeCount += vertex.second.size();
+    }
+
+    std::string out;
+    out.append(MAGIC, sizeof(MAGIC));
+    put(out, VERSION);
+    put(out, edges.size());
+    put(out, labels.size());
+    put(out, edgeCount);
+
+    for (std::string_view label : labels) {
+        put(out, label.size());
+        out.append(label.data(), label.size());
+    }
+    for (const auto& vertex : edges) {
+        put(out, (uint32_t) vertex.first.first);
+        put(out, labelIds[vertex.first.second]);
+    }
+    for (const auto& vertex : edges) {
+        uint32_t from = index[vertex.first.first];
+        for (const auto& successor : vertex.second) {
+            put(out, from);
+            put(out, index[successor.first]);
+        }
+    }
+
+    return out;
+}
+
+
+/**
+ * @brief Whether a buffer starts like a serialized graph.
+ * @param data Start of the buffer
+ * @param size Number of bytes available (at least 4 to tell)
+ */
+bool GraphSerializer::isSerialized(const char* data, size_t size) {
+    return size >= sizeof(MAGIC) && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+
+/**
+ * @brief Rebuild a graph from its binary representation.
+ * @param data Start of the serialized graph
+ * @param size Number of bytes available
+ * @param arena Arena that owns the graph, nullptr for a graph owned by the caller
+ * @throws std::runtime_error if the data is not a valid serialized graph.
+ * @return New directed UGraph
+ */
+UGraph<std::string>* GraphSerializer::deserialize(const char* data, size_t size, GraphArena* arena) {
+    UGraph<std::string>* graph = GraphArena::create(arena, true);
+    try {
+        deserialize(data, size, *graph);
+    } catch (...) {
+        GraphArena::discard(arena, graph);
+        throw;
+    }
+    return graph;
+}
+
+
+/**
+ * @brief Add the edges of a serialized graph to an existing graph. Labels are read in place
+ *        and copied once, into the graph's memory resource. UGraph keeps its adjacency in
+ *        ordered node-based containers (a map of vertex to successor set), so the arrays are
+ *        not mapped into it: every edge is inserted through UGraph::addEdge.
+ * @param data Start of the serialized graph
+ * @param size Number of bytes available
+ * @param graph Graph that receives the edges
+ * @throws std::runtime_error if the data is not a valid serialized graph.
+ */
+void GraphSerializer::deserialize(const char* data, size_t size, UGraph<std::string>& graph) {
+    const char* end = data + size;
+    if (!isSerialized(data, size)) {
+        throw std::runtime_error("GraphSerializer: unknown format");
+    }
+    data += sizeof(MAGIC);
+    if (get(data, end) != VERSION) {
+        throw std::runtime_error("GraphSerializer: unknown format");
+    }
+
+    uint32_t vertexCount = get(data, end);
+    uint32_t labelCount = get(data, end);
+    uint32_t edgeCount = get(data, end);
+
+    // Every count is bounded by the bytes left, so a corrupt header cannot reserve gigabytes
+    if ((size_t) (end - data) < (size_t) labelCount * sizeof(uint32_t) + ((size_t) vertexCount + edgeCount) * 2 * sizeof(uint32_t)) {
+        throw std::runtime_error("GraphSerializer: truncated graph");
+    }
+
+    std::vector<std::string_view> labels(labelCount);
+    for (std::string_view& label : labels) {
+        uint32_t length = get(data, end);
+        if ((size_t) (end - data) < length) {
+            throw std::runtime_error("GraphSerializer: truncated graph");
+        }
+        label = std::string_view(data, length);
+        data += length;
+    }
+
+    std::vector<std::pair<int, std::string_view>> vertexes(vertexCount);
+    for (auto& vertex : vertexes) {
+        vertex.first = (int) get(data, end);
+        uint32_t label = get(data, end);
+        if (label >= labelCount) {
+            throw std::runtime_error("GraphSerializer: invalid label");
+        }
+        vertex.second = labels[label];
+    }
+
+    for (uint32_t i = 0; i < edgeCount; i++) {
+        uint32_t from = get(data, end);
+        uint32_t to = get(data, end);
+        if (from >= vertexCount || to >= vertexCount) {
+            throw std::runtime_error("GraphSerializer: invalid edge");
+        }
+        graph.addEdge(vertexes[from].first, vertexes[from].second, vertexes[to].first, vertexes[to].second);
+    }
+}
+
+const char GraphSerializer::MAGIC[4] = {'C', 'F', 'G', 'B'};
+const uint32_t GraphSerializer::VERSION = 1;
+
+#endif // GRAPHSERIALIZER_H
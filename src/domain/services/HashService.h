@@ -0,0 +1,88 @@
+#ifndef HASHSERVICE_H
+#define HASHSERVICE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+/**
+ * @class HashService
+ * @brief Non-cryptographic content hashes used as cache and fingerprint keys.
+ */
+class HashService {
+    public:
+        static uint64_t mix(uint64_t);
+        static uint64_t hash(const char*, size_t, uint64_t = 0);
+        static uint64_t hash(const std::string&, uint64_t = 0);
+        static std::string hex(uint64_t);
+        static std::string digest(const std::string&);
+};
+
+
+/**
+ * @brief splitmix64 finalizer.
+ * @param x Value to scramble
+ * @return Scrambled value
+ */
+uint64_t HashService::mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+
+/**
+ * @brief 64-bit hash of a byte range (FNV-1a over 8-byte words, then mixed).
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @param seed Seed, so independent hashes can be combined
+ * @return Hash value
+ */
+uint64_t HashService::hash(const char* data, size_t size, uint64_t seed) {
+    uint64_t h = 0xCBF29CE484222325ull ^ mix(seed);
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        __builtin_memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++) {
+        h = (h ^ (unsigned char) data[i]) * 0x100000001B3ull;
+    }
+
+    return mix(h ^ size);
+}
+
+
+/**
+ * @brief 64-bit hash of a string.
+ */
+uint64_t HashService::hash(const std::string& data, uint64_t seed) {
+    return hash(data.data(), data.size(), seed);
+}
+
+
+/**
+ * @brief Fixed-width hexadecimal form of a hash.
+ */
+std::string HashService::hex(uint64_t value) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long) value);
+    return buffer;
+}
+
+
+/**
+ * @brief 128-bit hexadecimal digest (two independently seeded hashes).
+ * @param data Bytes to hash
+ * @return 32 hexadecimal characters
+ */
+std::string HashService::digest(const std::string& data) {
+    return hex(hash(data, 1)) + hex(hash(data, 2));
+}
+
+#endif // HASHSERVICE_H
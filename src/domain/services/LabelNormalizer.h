@@ -0,0 +1,188 @@
+#ifndef LABELNORMALIZER_H
+#define LABELNORMALIZER_H
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include "HashService.h"
+
+
+/**
+ * @class LabelNormalizer
+ * @brief Maps CFG vertex labels onto a smaller vocabulary before they are interned.
+ *        Labels are concatenated tree-sitter leaf types ("intidentifier=decimal_integer_literal;").
+ *        Runs of letters are split back into leaf types by longest match; keywords, operators
+ *        and the node types of the reserved words file are kept, identifier kinds become
+ *        "identifier" and literal kinds become "literal". Runs that cannot be split are kept as is.
+ */
+class LabelNormalizer {
+    private:
+        const static std::string VERSION;
+        const static std::filesystem::path JAVA;
+        const static std::string_view LITERAL;
+        const static std::unordered_map<std::string_view, std::string_view> CLASSES;
+
+        std::deque<std::string> words;
+        std::unordered_set<std::string_view> vocabulary;
+        size_t longest = 0;
+
+        void addWord(const std::string&);
+        size_t match(std::string_view) const;
+
+    public:
+        LabelNormalizer(const std::filesystem::path&);
+        ~LabelNormalizer();
+        static const LabelNormalizer& java();
+        static std::string version();
+        std::string normalize(std::string_view) const;
+};
+
+
+/**
+ * @brief Constructor for the LabelNormalizer class.
+ * @param reservedWords File with the node types and keywords to keep, separated by whitespace
+ */
+LabelNormalizer::LabelNormalizer(const std::filesystem::path& reservedWords) {
+    for (const auto& wordClass : CLASSES) {
+        addWord(std::string(wordClass.first));
+    }
+
+    std::ifstream file(reservedWords);
+    if (!file) {
+        std::cerr << "Cannot read " << reservedWords << ": only identifiers and literals are recognized" << std::endl;
+    }
+    std::string word;
+    while (file >> word) {
+        addWord(word);
+    }
+}
+
+
+/**
+ * @brief Destructor for the LabelNormalizer class.
+ */
+LabelNormalizer::~LabelNormalizer(){}
+
+
+/**
+ * @brief Normalizer for the Java labels of tools/AST.py and TreeSitterCFGBuilder, loaded once.
+ */
+const LabelNormalizer& LabelNormalizer::java() {
+    static const LabelNormalizer normalizer(JAVA);
+    return normalizer;
+}
+
+
+/**
+ * @brief Identity of the Java normalization: the version of the class table plus the digest of
+ *        the reserved words file, for keys of anything stored from normalized labels.
+ * @return Version string, changes whenever the normalized vocabulary may change
+ */
+std::string LabelNormalizer::version() {
+    std::ifstream file(JAVA, std::ios::in | std::ios::binary);
+    std::string words((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return VERSION + ":" + HashService::digest(words);
+}
+
+
+/**
+ * @brief Make a word known to the splitter.
+ */
+void LabelNormalizer::addWord(const std::string& word) {
+    if (vocabulary.count(word)) return;
+    words.push_back(word);
+    vocabulary.insert(words.back());
+    longest = std::max(longest, word.size());
+}
+
+
+/**
+ * @brief Length of the longest known word at the start of a run of letters.
+ * @param run Rest of the run
+ * @return Length of the word, 0 if no known word starts the run
+ */
+size_t LabelNormalizer::match(std::string_view run) const {
+    for (size_t size = std::min(longest, run.size()); size > 0; size--) {
+        if (vocabulary.count(run.substr(0, size))) {
+            return size;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Normalize a label.
+ * @param label Vertex label
+ * @return Label with identifiers and literals replaced by their class
+ */
+std::string LabelNormalizer::normalize(std::string_view label) const {
+    auto isWord = [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    };
+
+    std::string result;
+    result.reserve(label.size());
+    size_t i = 0;
+    while (i < label.size()) {
+        if (!isWord(label[i])) {
+            result += label[i++];
+            continue;
+        }
+
+        size_t end = i;
+        while (end < label.size() && isWord(label[end])) end++;
+        bool literal = false;
+        while (i < end) {
+            std::string_view run = label.substr(i, end - i);
+            size_t size = match(run);
+            if (!size) {
+                result += run;
+                break;
+            }
+            auto wordClass = CLASSES.find(run.substr(0, size));
+            if (wordClass == CLASSES.end()) {
+                result += run.substr(0, size);
+                literal = false;
+            } else if (!literal || wordClass->second != LITERAL) {
+                // Pieces of one string ("string_fragmentescape_sequence") are a single literal
+                result += wordClass->second;
+                literal = wordClass->second == LITERAL;
+            }
+            i += size;
+        }
+        i = end;
+    }
+    return result;
+}
+
+const std::string LabelNormalizer::VERSION = "normalizer:1"; // bump when CLASSES or normalize() change
+const std::filesystem::path LabelNormalizer::JAVA = "./domain/entities/reservedWords/java.txt";
+const std::string_view LabelNormalizer::LITERAL = "literal";
+const std::unordered_map<std::string_view, std::string_view> LabelNormalizer::CLASSES = {
+    {"identifier", "identifier"},
+    {"type_identifier", "identifier"},
+    {"decimal_integer_literal", LITERAL},
+    {"hex_integer_literal", LITERAL},
+    {"octal_integer_literal", LITERAL},
+    {"binary_integer_literal", LITERAL},
+    {"decimal_floating_point_literal", LITERAL},
+    {"hex_floating_point_literal", LITERAL},
+    {"character_literal", LITERAL},
+    {"string_literal", LITERAL},
+    {"string_fragment", LITERAL},
+    {"escape_sequence", LITERAL},
+    {"text_block", LITERAL},
+    {"null_literal", LITERAL},
+    {"true", LITERAL},
+    {"false", LITERAL},
+};
+
+#endif // LABELNORMALIZER_H
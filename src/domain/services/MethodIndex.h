@@ -0,0 +1,199 @@
+#ifndef METHODINDEX_H
+#define METHODINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "CFGStreamParser.h"
+#include "HashService.h"
+#include "LabelNormalizer.h"
+
+
+/**
+ * @class MethodIndex
+ * @brief Inverted index over the sub-CFGs of single methods. A method is fingerprinted by the set
+ *        of its transition shingles: hashes of the (normalized) label sequences along every path
+ *        of `length` edges. Each shingle has a posting list of the methods that contain it.
+ *        A query only walks the posting lists of its rarest shingles (prefix filtering): with
+ *        a Jaccard threshold t, any |Q| - ceil(t * |Q|) + 1 shingles of the query include one
+ *        that every match shares. Candidates are then verified exactly.
+ */
+class MethodIndex {
+    private:
+        struct Entry {
+            std::vector<uint64_t> shingles;
+        };
+
+        size_t length;
+        size_t minimumShingles;
+        std::vector<Entry> entries;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> postings;
+
+        static size_t overlap(const std::vector<uint64_t>&, const std::vector<uint64_t>&);
+
+    public:
+        MethodIndex(size_t = 2, size_t = 4);
+        ~MethodIndex();
+        std::vector<uint64_t> shingles(const CFGStreamParser::Method&) const;
+        size_t add(const std::vector<uint64_t>&);
+        size_t size() const;
+        std::vector<std::pair<size_t, double>> query(const std::vector<uint64_t>&, double) const;
+};
+
+
+/**
+ * @brief Constructor for the MethodIndex class.
+ * @param length Edges per shingle (methods without such a path use single edges)
+ * @param minimumShingles Smaller methods (getters, setters...) are neither indexed nor queried
+ */
+MethodIndex::MethodIndex(size_t length, size_t minimumShingles) : length(std::max<size_t>(length, 1)), minimumShingles(minimumShingles) {}
+
+
+/**
+ * @brief Destructor for the MethodIndex class.
+ */
+MethodIndex::~MethodIndex(){}
+
+
+/**
+ * @brief Fingerprint of a method.
+ * @param method Sub-CFG of the method
+ * @return Sorted, distinct shingle hashes
+ */
+std::vector<uint64_t> MethodIndex::shingles(const CFGStreamParser::Method& method) const {
+    const LabelNormalizer& normalizer = LabelNormalizer::java();
+    std::vector<uint64_t> labels;
+    for (const std::string& label : method.labels) {
+        labels.push_back(HashService::hash(normalizer.normalize(label)));
+    }
+
+    std::vector<std::vector<int>> successors(labels.size());
+    for (const auto& edge : method.edges) {
+        successors[edge.first].push_back(edge.second);
+    }
+
+    // Extend every path one edge at a time, carrying the hash of its labels
+    std::vector<uint64_t> result;
+    for (size_t steps = length; steps > 0 && result.empty(); steps--) {
+        std::vector<std::pair<int, uint64_t>> paths;
+        for (size_t v = 0; v < labels.size(); v++) {
+            paths.push_back(std::make_pair((int) v, labels[v]));
+        }
+        for (size_t step = 0; step < steps; step++) {
+            std::vector<std::pair<int, uint64_t>> longer;
+            for (const auto& path : paths) {
+                for (int next : successors[path.first]) {
+                    longer.push_back(std::make_pair(next, HashService::mix(path.second * 31 + labels[next])));
+                }
+            }
+            paths.swap(longer);
+        }
+        for (const auto& path : paths) {
+            result.push_back(path.second);
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+
+/**
+ * @brief Index a method.
+ * @param shingles Fingerprint from shingles()
+ * @return Id of the method (consecutive from 0), or size_t(-1) if the method is too small to index
+ */
+size_t MethodIndex::add(const std::vector<uint64_t>& shingles) {
+    if (shingles.size() < minimumShingles) {
+        return (size_t) -1;
+    }
+    uint32_t id = entries.size();
+    entries.push_back(Entry{shingles});
+    for (uint64_t shingle : shingles) {
+        postings[shingle].push_back(id);
+    }
+    return id;
+}
+
+
+/**
+ * @brief Number of indexed methods.
+ */
+size_t MethodIndex::size() const {
+    return entries.size();
+}
+
+
+/**
+ * @brief Shared elements of two sorted sets.
+ */
+size_t MethodIndex::overlap(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+    size_t shared = 0, i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (b[j] < a[i]) {
+            j++;
+        } else {
+            shared++;
+            i++;
+            j++;
+        }
+    }
+    return shared;
+}
+
+
+/**
+ * @brief Indexed methods whose fingerprint is similar to a query's.
+ * @param shingles Fingerprint of the query method
+ * @param threshold Minimum Jaccard similarity, greater than 0
+ * @return Method ids with their Jaccard similarity, most similar first
+ */
+std::vector<std::pair<size_t, double>> MethodIndex::query(const std::vector<uint64_t>& shingles, double threshold) const {
+    std::vector<std::pair<size_t, double>> result;
+    if (shingles.size() < minimumShingles || entries.empty()) {
+        return result;
+    }
+
+    // Rarest shingles first; shingles nobody has cannot find anything
+    std::vector<std::pair<size_t, const std::vector<uint32_t>*>> lists;
+    for (uint64_t shingle : shingles) {
+        auto posting = postings.find(shingle);
+        lists.push_back(std::make_pair(posting == postings.end() ? 0 : posting->second.size(), posting == postings.end() ? nullptr : &posting->second));
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    size_t required = (size_t) std::ceil(std::max(threshold, 1e-9) * shingles.size() - 1e-9);
+    size_t prefix = shingles.size() - std::max<size_t>(required, 1) + 1;
+    std::vector<uint32_t> candidates;
+    for (size_t i = 0; i < prefix; i++) {
+        if (lists[i].second) {
+            candidates.insert(candidates.end(), lists[i].second->begin(), lists[i].second->end());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (uint32_t candidate : candidates) {
+        const std::vector<uint64_t>& other = entries[candidate].shingles;
+        size_t shared = overlap(shingles, other);
+        double score = (double) shared / (shingles.size() + other.size() - shared);
+        if (score >= threshold) {
+            result.push_back(std::make_pair((size_t) candidate, score));
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.second > b.second;
+    });
+    return result;
+}
+
+#endif // METHODINDEX_H
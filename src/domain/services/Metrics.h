@@ -0,0 +1,314 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+
+/**
+ * @class Metrics
+ * @brief Process-wide stage timers and counters of the detection pipeline.
+ *        Each thread writes to its own shard with relaxed atomics, so recording never contends;
+ *        reports sum the shards (per run) and also list them one by one (per thread).
+ *        Shards of finished threads are reused by new ones, keeping the report bounded.
+ */
+class Metrics {
+    public:
+        enum Stage { SPAWN, EXTRACT, PARSE, CACHE_LOOKUP, CACHE_STORE, FREEZE, TRANSITIONS, SIMILARITY, DENSE_SIMILARITY, FINGERPRINT, REQUEST, STAGES };
+        enum Counter { FILES, ERRORS, CACHE_HITS, CACHE_MISSES, VERTICES, EDGES, VOCABULARY, NONZEROS, BYTES_READ, PAIRS, PAIRS_REJECTED, PAIRS_FILTERED, DUPLICATES, METHODS_BUILT, METHODS_REUSED, SCORES_REUSED, SCORES_STORED, BUDGET_WALL, BUDGET_CPU, BUDGET_RSS, TILES, TILES_RETRIED, TILES_FAILED, COUNTERS };
+
+        /**
+         * @class Timer
+         * @brief Records the lifetime of its scope into a stage.
+         */
+        class Timer {
+            private:
+                Stage stage;
+                uint64_t start;
+
+            public:
+                Timer(Stage stage) : stage(stage), start(now()) {}
+                ~Timer() { record(stage, now() - start); }
+        };
+
+        static uint64_t now();
+        static void record(Stage, uint64_t);
+        static void add(Counter, uint64_t = 1);
+        static void reset();
+        static std::string toJson();
+        static std::string toPrometheus();
+
+    private:
+        const static size_t BUCKETS = 22;
+        const static std::array<uint64_t, BUCKETS> BOUNDS;
+        const static std::array<const char*, STAGES> STAGE_NAMES;
+        const static std::array<const char*, COUNTERS> COUNTER_NAMES;
+
+        struct Shard {
+            size_t id = 0;
+            std::atomic<bool> active{false};
+            std::atomic<uint64_t> calls[STAGES] = {};
+            std::atomic<uint64_t> nanoseconds[STAGES] = {};
+            std::atomic<uint64_t> histogram[STAGES][BUCKETS + 1] = {};
+            std::atomic<uint64_t> counters[COUNTERS] = {};
+        };
+
+        struct Totals {
+            uint64_t calls[STAGES] = {};
+            uint64_t nanoseconds[STAGES] = {};
+            uint64_t histogram[STAGES][BUCKETS + 1] = {};
+            uint64_t counters[COUNTERS] = {};
+
+            void add(const Shard&);
+            bool empty() const;
+        };
+
+        struct Registry {
+            std::mutex lock;
+            std::deque<Shard> shards;
+        };
+
+        struct Owner {
+            Shard* shard = nullptr;
+            ~Owner() { if (shard) shard->active = false; }
+        };
+
+        static Registry& registry();
+        static Shard& local();
+        static void json(std::ostringstream&, const Totals&);
+};
+
+
+/**
+ * @brief Monotonic clock in nanoseconds.
+ */
+uint64_t Metrics::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * @brief Shards of every thread that ever recorded something.
+ */
+Metrics::Registry& Metrics::registry() {
+    static Registry instance;
+    return instance;
+}
+
+
+/**
+ * @brief Shard of the calling thread, claimed on first use.
+ */
+Metrics::Shard& Metrics::local() {
+    thread_local Owner owner;
+    if (owner.shard) {
+        return *owner.shard;
+    }
+
+    Registry& shards = registry();
+    std::lock_guard<std::mutex> guard(shards.lock);
+    for (Shard& shard : shards.shards) {
+        if (!shard.active) {
+            owner.shard = &shard;
+            break;
+        }
+    }
+    if (!owner.shard) {
+        shards.shards.emplace_back();
+        owner.shard = &shards.shards.back();
+        owner.shard->id = shards.shards.size() - 1;
+    }
+    owner.shard->active = true;
+    return *owner.shard;
+}
+
+
+/**
+ * @brief Add one measurement to a stage.
+ * @param stage Stage measured
+ * @param nanoseconds Elapsed time
+ */
+void Metrics::record(Stage stage, uint64_t nanoseconds) {
+    Shard& shard = local();
+    size_t bucket = 0;
+    while (bucket < BUCKETS && nanoseconds > BOUNDS[bucket]) {
+        bucket++;
+    }
+
+    shard.calls[stage].fetch_add(1, std::memory_order_relaxed);
+    shard.nanoseconds[stage].fetch_add(nanoseconds, std::memory_order_relaxed);
+    shard.histogram[stage][bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Increment a counter.
+ * @param counter Counter to increment
+ * @param amount Increment
+ */
+void Metrics::add(Counter counter, uint64_t amount) {
+    local().counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Zero every shard, to start a new run.
+ */
+void Metrics::reset() {
+    Registry& shards = registry();
+    std::lock_guard<std::mutex> guard(shards.lock);
+    for (Shard& shard : shards.shards) {
+        for (size_t s = 0; s < STAGES; s++) {
+            shard.calls[s] = 0;
+            shard.nanoseconds[s] = 0;
+            for (size_t b = 0; b <= BUCKETS; b++) shard.histogram[s][b] = 0;
+        }
+        for (size_t c = 0; c < COUNTERS; c++) shard.counters[c] = 0;
+    }
+}
+
+
+/**
+ * @brief Accumulate a shard.
+ */
+void Metrics::Totals::add(const Shard& shard) {
+    for (size_t s = 0; s < STAGES; s++) {
+        calls[s] += shard.calls[s].load(std::memory_order_relaxed);
+        nanoseconds[s] += shard.nanoseconds[s].load(std::memory_order_relaxed);
+        for (size_t b = 0; b <= BUCKETS; b++) {
+            histogram[s][b] += shard.histogram[s][b].load(std::memory_order_relaxed);
+        }
+    }
+    for (size_t c = 0; c < COUNTERS; c++) {
+        counters[c] += shard.counters[c].load(std::memory_order_relaxed);
+    }
+}
+
+
+/**
+ * @brief Whether nothing was recorded.
+ */
+bool Metrics::Totals::empty() const {
+    for (size_t s = 0; s < STAGES; s++) if (calls[s]) return false;
+    for (size_t c = 0; c < COUNTERS; c++) if (counters[c]) return false;
+    return true;
+}
+
+
+/**
+ * @brief Write the counters and stages of a total as JSON members.
+ */
+void Metrics::json(std::ostringstream& out, const Totals& totals) {
+    out << "\"counters\": {";
+    for (size_t c = 0; c < COUNTERS; c++) {
+        out << (c ? ", " : "") << "\"" << COUNTER_NAMES[c] << "\": " << totals.counters[c];
+    }
+    out << "}, \"stages\": {";
+    bool first = true;
+    for (size_t s = 0; s < STAGES; s++) {
+        if (!totals.calls[s]) continue;
+        out << (first ? "" : ", ") << "\"" << STAGE_NAMES[s] << "\": {\"calls\": " << totals.calls[s]
+            << ", \"seconds\": " << totals.nanoseconds[s] / 1e9
+            << ", \"mean_seconds\": " << totals.nanoseconds[s] / 1e9 / totals.calls[s]
+            << ", \"histogram\": [";
+        for (size_t b = 0; b <= BUCKETS; b++) {
+            out << (b ? ", " : "") << "{\"le\": ";
+            if (b < BUCKETS) out << BOUNDS[b] / 1e9;
+            else out << "\"+Inf\"";
+            out << ", \"count\": " << totals.histogram[s][b] << "}";
+        }
+        out << "]}";
+        first = false;
+    }
+    out << "}";
+}
+
+
+/**
+ * @brief Report of the current run as JSON: totals and one entry per thread.
+ *        Histogram buckets are per-bucket counts with their upper bound in seconds.
+ * @return JSON document
+ */
+std::string Metrics::toJson() {
+    Registry& shards = registry();
+    std::lock_guard<std::mutex> guard(shards.lock);
+    std::ostringstream out;
+    out << std::setprecision(9);
+
+    Totals run;
+    for (const Shard& shard : shards.shards) run.add(shard);
+
+    out << "{";
+    json(out, run);
+    out << ", \"threads\": [";
+    bool first = true;
+    for (const Shard& shard : shards.shards) {
+        Totals thread;
+        thread.add(shard);
+        if (thread.empty()) continue;
+        out << (first ? "" : ", ") << "{\"thread\": " << shard.id << ", ";
+        json(out, thread);
+        out << "}";
+        first = false;
+    }
+    out << "]}\n";
+    return out.str();
+}
+
+
+/**
+ * @brief Report of the current run in the Prometheus text exposition format.
+ * @return Exposition text
+ */
+std::string Metrics::toPrometheus() {
+    Registry& shards = registry();
+    std::lock_guard<std::mutex> guard(shards.lock);
+    std::ostringstream out;
+    out << std::setprecision(9);
+
+    Totals run;
+    for (const Shard& shard : shards.shards) run.add(shard);
+
+    for (size_t c = 0; c < COUNTERS; c++) {
+        out << "# TYPE plagiarism_" << COUNTER_NAMES[c] << "_total counter\n"
+            << "plagiarism_" << COUNTER_NAMES[c] << "_total " << run.counters[c] << "\n";
+    }
+
+    out << "# TYPE plagiarism_stage_seconds histogram\n";
+    for (size_t s = 0; s < STAGES; s++) {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b <= BUCKETS; b++) {
+            cumulative += run.histogram[s][b];
+            out << "plagiarism_stage_seconds_bucket{stage=\"" << STAGE_NAMES[s] << "\",le=\"";
+            if (b < BUCKETS) out << BOUNDS[b] / 1e9;
+            else out << "+Inf";
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "plagiarism_stage_seconds_sum{stage=\"" << STAGE_NAMES[s] << "\"} " << run.nanoseconds[s] / 1e9 << "\n"
+            << "plagiarism_stage_seconds_count{stage=\"" << STAGE_NAMES[s] << "\"} " << run.calls[s] << "\n";
+    }
+    return out.str();
+}
+
+// 1us to 10s, 1-2.5-5 steps
+const std::array<uint64_t, Metrics::BUCKETS> Metrics::BOUNDS = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+    1000000000, 2500000000, 5000000000, 10000000000
+};
+const std::array<const char*, Metrics::STAGES> Metrics::STAGE_NAMES = {
+    "spawn", "extract", "parse", "cache_lookup", "cache_store", "freeze", "transitions", "similarity", "dense_similarity", "fingerprint", "request"
+};
+const std::array<const char*, Metrics::COUNTERS> Metrics::COUNTER_NAMES = {
+    "files", "errors", "cache_hits", "cache_misses", "vertices", "edges", "vocabulary", "nonzeros", "bytes_read", "pairs", "pairs_rejected", "pairs_filtered", "duplicates", "methods_built", "methods_reused", "scores_reused", "scores_stored", "budget_wall", "budget_cpu", "budget_rss", "tiles", "tiles_retried", "tiles_failed"
+};
+
+#endif // METRICS_H
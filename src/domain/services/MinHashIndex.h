@@ -0,0 +1,179 @@
+#ifndef MINHASHINDEX_H
+#define MINHASHINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../entities/TransitionVector.h"
+#include "HashService.h"
+
+
+/**
+ * @class MinHashIndex
+ * @brief Locality-sensitive index over the (label -> successor label) transition sets of CFGs.
+ *        Each set is sketched with bands * rows MinHash values; two entries become candidates
+ *        when all rows of at least one band match. The Jaccard similarity at which a pair
+ *        has a 50% chance of being retrieved is about (1 / bands) ^ (1 / rows): more bands or
+ *        fewer rows favor recall, fewer bands or more rows favor speed.
+ */
+class MinHashIndex {
+    private:
+        size_t bands;
+        size_t rows;
+        std::vector<uint64_t> seeds;
+        std::vector<std::unordered_map<uint64_t, std::vector<size_t>>> buckets;
+        size_t entries;
+
+        uint64_t bandKey(const std::vector<uint64_t>&, size_t) const;
+
+    public:
+        MinHashIndex(size_t = 16, size_t = 4, uint64_t = 0x9E3779B97F4A7C15ull);
+        ~MinHashIndex();
+        double estimatedThreshold() const;
+        size_t size() const;
+        std::vector<uint64_t> sketch(const TransitionVector&) const;
+        size_t add(const std::vector<uint64_t>&);
+        std::vector<size_t> query(const std::vector<uint64_t>&) const;
+        std::vector<std::pair<size_t, size_t>> candidatePairs() const;
+};
+
+
+/**
+ * @brief Constructor for the MinHashIndex class.
+ * @param bands Number of LSH bands
+ * @param rows MinHash values per band
+ * @param seed Seed of the hash family
+ * @throws std::invalid_argument if bands or rows is 0.
+ */
+MinHashIndex::MinHashIndex(size_t bands, size_t rows, uint64_t seed) : bands(bands), rows(rows), buckets(bands), entries(0) {
+    if (!bands || !rows) {
+        throw std::invalid_argument("MinHashIndex: bands and rows must be positive");
+    }
+    for (size_t i = 0; i < bands * rows; i++) {
+        seed = HashService::mix(seed + i);
+        seeds.push_back(seed);
+    }
+}
+
+
+/**
+ * @brief Destructor for the MinHashIndex class.
+ */
+MinHashIndex::~MinHashIndex(){}
+
+
+/**
+ * @brief Hash the rows of one band of a signature.
+ */
+uint64_t MinHashIndex::bandKey(const std::vector<uint64_t>& signature, size_t band) const {
+    uint64_t key = band;
+    for (size_t r = 0; r < rows; r++) {
+        key = HashService::mix(key ^ signature[band * rows + r]);
+    }
+    return key;
+}
+
+
+/**
+ * @brief Jaccard similarity with a 50% retrieval probability, (1 / bands) ^ (1 / rows).
+ */
+double MinHashIndex::estimatedThreshold() const {
+    return std::pow(1.0 / bands, 1.0 / rows);
+}
+
+
+/**
+ * @brief Number of indexed signatures.
+ */
+size_t MinHashIndex::size() const {
+    return entries;
+}
+
+
+/**
+ * @brief MinHash signature of a CFG's set of transitions.
+ * @param matrix Transition matrix whose keys form the set
+ * @return bands * rows minimum hashes (all max for an empty set)
+ */
+std::vector<uint64_t> MinHashIndex::sketch(const TransitionVector& matrix) const {
+    std::vector<uint64_t> signature(seeds.size(), std::numeric_limits<uint64_t>::max());
+
+    for (uint64_t key : matrix.getKeys()) {
+        for (size_t i = 0; i < seeds.size(); i++) {
+            signature[i] = std::min(signature[i], HashService::mix(key ^ seeds[i]));
+        }
+    }
+    return signature;
+}
+
+
+/**
+ * @brief Index a signature. Empty sets get an id but are never retrieved.
+ * @param signature Signature from sketch
+ * @return Id of the entry (insertion order)
+ */
+size_t MinHashIndex::add(const std::vector<uint64_t>& signature) {
+    size_t id = entries++;
+    if (signature[0] == std::numeric_limits<uint64_t>::max()) {
+        return id;
+    }
+    for (size_t b = 0; b < bands; b++) {
+        buckets[b][bandKey(signature, b)].push_back(id);
+    }
+    return id;
+}
+
+
+/**
+ * @brief Entries sharing at least one band with a signature.
+ * @param signature Signature from sketch
+ * @return Sorted ids of the candidates
+ */
+std::vector<size_t> MinHashIndex::query(const std::vector<uint64_t>& signature) const {
+    std::vector<size_t> candidates;
+    if (signature[0] == std::numeric_limits<uint64_t>::max()) {
+        return candidates;
+    }
+
+    for (size_t b = 0; b < bands; b++) {
+        auto it = buckets[b].find(bandKey(signature, b));
+        if (it != buckets[b].end()) {
+            candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    return candidates;
+}
+
+
+/**
+ * @brief Every pair of indexed entries that share a bucket.
+ * @return Sorted (first < second) pairs of ids
+ */
+std::vector<std::pair<size_t, size_t>> MinHashIndex::candidatePairs() const {
+    std::vector<std::pair<size_t, size_t>> pairs;
+
+    for (const auto& band : buckets) {
+        for (const auto& bucket : band) {
+            const std::vector<size_t>& ids = bucket.second;
+            for (size_t i = 0; i < ids.size(); i++) {
+                for (size_t j = i + 1; j < ids.size(); j++) {
+                    pairs.push_back(std::make_pair(ids[i], ids[j]));
+                }
+            }
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    return pairs;
+}
+
+#endif // MINHASHINDEX_H
@@ -0,0 +1,179 @@
+#ifndef PROCESSWATCHDOG_H
+#define PROCESSWATCHDOG_H
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "../entities/ExtractionBudget.h"
+#include "Metrics.h"
+
+
+/**
+ * @class ProcessWatchdog
+ * @brief Enforces an ExtractionBudget on an extractor process while its output is read.
+ *        Instead of blocking on the pipe, the reader waits through the watchdog, which wakes up
+ *        at least every CHECK_INTERVAL milliseconds to compare the time since the watchdog was
+ *        created, the CPU time the process used since then and its resident set size
+ *        (/proc/<pid>/stat and /proc/<pid>/statm) against the budget. A process over budget is
+ *        killed with SIGKILL, its process group too when it leads one, and the wait throws.
+ */
+class ProcessWatchdog {
+    private:
+        const static int CHECK_INTERVAL;
+
+        pid_t pid;
+        ExtractionBudget budget;
+        uint64_t start;
+        uint64_t lastCheck;
+        double cpuStart;
+
+        static bool usage(pid_t, double&, size_t&);
+        void kill(Metrics::Counter, const std::string&);
+
+    public:
+        ProcessWatchdog(pid_t, const ExtractionBudget&);
+        ~ProcessWatchdog();
+        void check();
+        void wait(int);
+};
+
+
+/**
+ * @brief Start watching a process; its budget counts from now.
+ * @param pid Extractor process
+ * @param budget Limits to enforce
+ */
+ProcessWatchdog::ProcessWatchdog(pid_t pid, const ExtractionBudget& budget) : pid(pid), budget(budget), start(Metrics::now()), lastCheck(0), cpuStart(0) {
+    size_t rss;
+    if (budget.cpuSeconds && !usage(pid, cpuStart, rss)) {
+        cpuStart = 0;
+    }
+}
+
+
+/**
+ * @brief Destructor for the ProcessWatchdog class.
+ */
+ProcessWatchdog::~ProcessWatchdog(){}
+
+
+/**
+ * @brief CPU time (user + system) and resident set size of a running process.
+ * @return False if the process is gone or /proc cannot be read
+ */
+bool ProcessWatchdog::usage(pid_t pid, double& cpuSeconds, size_t& rssBytes) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+    std::FILE* stat = std::fopen(path, "r");
+    if (!stat) return false;
+    char line[1024];
+    size_t length = std::fread(line, 1, sizeof(line) - 1, stat);
+    std::fclose(stat);
+    line[length] = '\0';
+
+    // Fields after the command name, which may hold spaces: state is field 3, utime 14, stime 15
+    const char* fields = strrchr(line, ')');
+    if (!fields) return false;
+    std::istringstream stream(fields + 1);
+    std::string field;
+    unsigned long long user = 0, system = 0;
+    for (int i = 3; i <= 15 && stream >> field; i++) {
+        if (i == 14) user = std::stoull(field);
+        if (i == 15) system = std::stoull(field);
+    }
+    cpuSeconds = (double) (user + system) / sysconf(_SC_CLK_TCK);
+
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int) pid);
+    std::FILE* statm = std::fopen(path, "r");
+    if (!statm) return false;
+    unsigned long long size = 0, resident = 0;
+    bool parsed = std::fscanf(statm, "%llu %llu", &size, &resident) == 2;
+    std::fclose(statm);
+    rssBytes = resident * sysconf(_SC_PAGESIZE);
+    return parsed;
+}
+
+
+/**
+ * @brief Kill the process over budget, record the outcome and report it.
+ * @throws std::runtime_error always.
+ */
+void ProcessWatchdog::kill(Metrics::Counter counter, const std::string& reason) {
+    if (getpgid(pid) == pid) {
+        ::kill(-pid, SIGKILL);
+    }
+    ::kill(pid, SIGKILL);
+    Metrics::add(counter);
+    throw std::runtime_error("ProcessWatchdog: " + reason + " budget exceeded, extractor killed");
+}
+
+
+/**
+ * @brief Compare the process against its budget now.
+ * @throws std::runtime_error if the process was over budget (it has been killed).
+ */
+void ProcessWatchdog::check() {
+    uint64_t now = Metrics::now();
+    if (budget.wallSeconds && now - start > budget.wallSeconds * 1e9) {
+        kill(Metrics::BUDGET_WALL, "wall-clock");
+    }
+    if ((!budget.cpuSeconds && !budget.rssBytes) || now - lastCheck < CHECK_INTERVAL * 1000000ull) {
+        return;
+    }
+    lastCheck = now;
+
+    double cpu;
+    size_t rss;
+    if (!usage(pid, cpu, rss)) {
+        return;
+    }
+    if (budget.cpuSeconds && cpu - cpuStart > budget.cpuSeconds) {
+        kill(Metrics::BUDGET_CPU, "CPU");
+    }
+    if (budget.rssBytes && rss > budget.rssBytes) {
+        kill(Metrics::BUDGET_RSS, "memory");
+    }
+}
+
+
+/**
+ * @brief Block until a pipe of the process has data or is closed, enforcing the budget meanwhile.
+ *        Returns at once without a budget, leaving the caller to block in read.
+ * @param fd Pipe to wait on
+ * @throws std::runtime_error if the process went over budget (it has been killed).
+ */
+void ProcessWatchdog::wait(int fd) {
+    if (budget.unlimited()) return;
+
+    while (true) {
+        check();
+        int timeout = CHECK_INTERVAL;
+        if (budget.wallSeconds) {
+            double left = budget.wallSeconds * 1e3 - (Metrics::now() - start) / 1e6;
+            timeout = std::max(0, std::min(timeout, (int) left + 1));
+        }
+
+        struct pollfd ready = {fd, POLLIN, 0};
+        int events = poll(&ready, 1, timeout);
+        if (events < 0 && errno != EINTR) {
+            throw std::runtime_error("ProcessWatchdog: cannot poll pipe");
+        }
+        if (events > 0) {
+            check();
+            return;
+        }
+    }
+}
+
+const int ProcessWatchdog::CHECK_INTERVAL = 50; // milliseconds
+
+#endif // PROCESSWATCHDOG_H
@@ -0,0 +1,334 @@
+#ifndef SCORESTORE_H
+#define SCORESTORE_H
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "HashService.h"
+
+
+/**
+ * @class ScoreStore
+ * @brief Append-only on-disk memo of pair scores, so a rerun over a grown corpus only scores
+ *        the new pairs. Pairs are keyed by the content hashes of both files and a hash of the
+ *        scoring version (extractor, normalizer and similarity); records of other versions are
+ *        ignored. A score is either exact, or only known to be below the cutoff it was computed
+ *        against (SimilarityService::similarityAtLeast).
+ *        Layout, in host byte order: "PSCR" and version (uint32 each), then fixed-size records
+ *        (uint64 first, second, version, checksum; double score, cutoff). Later records supersede
+ *        earlier ones; compact() rewrites the file with the live records only.
+ *        The whole store is indexed in memory, by pair and by file.
+ */
+class ScoreStore {
+    public:
+        struct Score {
+            uint64_t first;
+            uint64_t second;
+            double score;
+            double cutoff;
+        };
+
+    private:
+        struct Record {
+            uint64_t first;
+            uint64_t second;
+            uint64_t version;
+            uint64_t checksum;
+            double score;
+            double cutoff;
+        };
+
+        struct PairHash {
+            size_t operator()(const std::pair<uint64_t, uint64_t>& key) const { return HashService::mix(key.first ^ HashService::mix(key.second)); }
+        };
+
+        const static uint32_t MAGIC;
+        const static uint32_t VERSION;
+        const static size_t HEADER;
+
+        std::filesystem::path file;
+        uint64_t version;
+        int fd;
+        size_t records;
+        std::unordered_map<std::pair<uint64_t, uint64_t>, std::pair<double, double>, PairHash> scores;
+        std::unordered_map<uint64_t, std::vector<uint64_t>> partners;
+        mutable std::shared_mutex lock;
+
+        static uint64_t checksum(const Record&);
+        static std::pair<uint64_t, uint64_t> key(uint64_t, uint64_t);
+        Record record(const std::pair<uint64_t, uint64_t>&, const std::pair<double, double>&) const;
+        void insert(uint64_t, uint64_t, double, double);
+        void load();
+
+    public:
+        ScoreStore(const std::filesystem::path&, const std::string&);
+        ~ScoreStore();
+        ScoreStore(const ScoreStore&) = delete;
+        ScoreStore& operator=(const ScoreStore&) = delete;
+        static uint64_t contentKey(const std::string&);
+        bool get(uint64_t, uint64_t, double, double&) const;
+        void put(const std::vector<Score>&);
+        std::vector<Score> scoresOf(uint64_t) const;
+        size_t size() const;
+        size_t deadRecords() const;
+        void compact();
+};
+
+
+/**
+ * @brief Open a store, creating it if missing, and index its records of one scoring version.
+ *        A torn record at the end of the file (interrupted append) is cut off.
+ * @param file Store file
+ * @param scoringVersion Identity of everything a score depends on besides the two sources
+ * @throws std::runtime_error if the file cannot be opened or is not a score store.
+ */
+ScoreStore::ScoreStore(const std::filesystem::path& file, const std::string& scoringVersion) : file(file), version(HashService::hash(scoringVersion)), fd(-1), records(0) {
+    load();
+}
+
+
+/**
+ * @brief Destructor for the ScoreStore class. Closes the file.
+ */
+ScoreStore::~ScoreStore(){
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+
+/**
+ * @brief Open the file, write the header of a new store and read every record.
+ */
+void ScoreStore::load() {
+    fd = open(file.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("ScoreStore: cannot open " + file.string());
+    }
+
+    struct stat info;
+    uint32_t header[2] = {MAGIC, VERSION};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        fd = -1;
+        throw std::runtime_error("ScoreStore: cannot read " + file.string());
+    }
+    if (info.st_size == 0) {
+        if (write(fd, header, sizeof(header)) != (ssize_t) sizeof(header)) {
+            close(fd);
+            fd = -1;
+            throw std::runtime_error("ScoreStore: cannot write " + file.string());
+        }
+        return;
+    }
+
+    std::vector<char> data(info.st_size);
+    if (pread(fd, data.data(), data.size(), 0) != (ssize_t) data.size() || data.size() < HEADER || memcmp(data.data(), header, sizeof(header)) != 0) {
+        close(fd);
+        fd = -1;
+        throw std::runtime_error("ScoreStore: not a score store " + file.string());
+    }
+
+    size_t count = (data.size() - HEADER) / sizeof(Record);
+    for (size_t i = 0; i < count; i++) {
+        Record entry;
+        memcpy(&entry, data.data() + HEADER + i * sizeof(Record), sizeof(Record));
+        records++;
+        if (entry.checksum == checksum(entry) && entry.version == version) {
+            insert(entry.first, entry.second, entry.score, entry.cutoff);
+        }
+    }
+    if (HEADER + count * sizeof(Record) != data.size() && ftruncate(fd, HEADER + count * sizeof(Record)) != 0) {
+        close(fd);
+        fd = -1;
+        throw std::runtime_error("ScoreStore: cannot repair " + file.string());
+    }
+}
+
+
+/**
+ * @brief Content key of a source file, the identity of a file in the store.
+ * @param source File bytes
+ * @return 64-bit hash, never 0
+ */
+uint64_t ScoreStore::contentKey(const std::string& source) {
+    return HashService::hash(source) | 1;
+}
+
+
+/**
+ * @brief Order the two content keys, scores being symmetric.
+ */
+std::pair<uint64_t, uint64_t> ScoreStore::key(uint64_t first, uint64_t second) {
+    return first < second ? std::make_pair(first, second) : std::make_pair(second, first);
+}
+
+
+/**
+ * @brief Detects torn or foreign bytes in a record.
+ */
+uint64_t ScoreStore::checksum(const Record& entry) {
+    uint64_t score, cutoff;
+    memcpy(&score, &entry.score, sizeof(score));
+    memcpy(&cutoff, &entry.cutoff, sizeof(cutoff));
+    return HashService::mix(HashService::mix(HashService::mix(entry.first ^ entry.version) ^ entry.second) ^ score) + cutoff;
+}
+
+
+/**
+ * @brief Record of a live score.
+ */
+ScoreStore::Record ScoreStore::record(const std::pair<uint64_t, uint64_t>& pair, const std::pair<double, double>& score) const {
+    Record entry{pair.first, pair.second, version, 0, score.first, score.second};
+    entry.checksum = checksum(entry);
+    return entry;
+}
+
+
+/**
+ * @brief Index a score, replacing the one of the same pair. Caller holds the lock.
+ */
+void ScoreStore::insert(uint64_t first, uint64_t second, double score, double cutoff) {
+    auto inserted = scores.insert_or_assign(key(first, second), std::make_pair(score, cutoff));
+    if (inserted.second) {
+        partners[first].push_back(second);
+        if (first != second) partners[second].push_back(first);
+    }
+}
+
+
+/**
+ * @brief Look up a pair for a given threshold.
+ * @param first Content key of one file
+ * @param second Content key of the other file
+ * @param threshold Cutoff the caller scores against
+ * @param score Set to the stored score on a hit
+ * @return True if the stored score is exact, or known to be below threshold
+ */
+bool ScoreStore::get(uint64_t first, uint64_t second, double threshold, double& score) const {
+    std::shared_lock<std::shared_mutex> reader(lock);
+    auto it = scores.find(key(first, second));
+    if (it == scores.end()) {
+        return false;
+    }
+    const std::pair<double, double>& stored = it->second;
+    if (stored.first >= stored.second || threshold >= stored.second) {
+        score = stored.first;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * @brief Append scores in one write and index them. Failures to write are ignored (the
+ *        scores stay indexed for this run), the store is only an accelerator.
+ * @param batch Scores to store; each is exact when score >= cutoff
+ */
+void ScoreStore::put(const std::vector<Score>& batch) {
+    if (batch.empty()) return;
+    std::vector<Record> entries;
+    entries.reserve(batch.size());
+
+    std::unique_lock<std::shared_mutex> writer(lock);
+    for (const Score& score : batch) {
+        insert(score.first, score.second, score.score, score.cutoff);
+        entries.push_back(record(key(score.first, score.second), std::make_pair(score.score, score.cutoff)));
+    }
+    if (write(fd, entries.data(), entries.size() * sizeof(Record)) == (ssize_t) (entries.size() * sizeof(Record))) {
+        records += entries.size();
+    }
+}
+
+
+/**
+ * @brief Every stored score involving a file.
+ * @param file Content key of the file
+ * @return Scores with file as first, in insertion order
+ */
+std::vector<ScoreStore::Score> ScoreStore::scoresOf(uint64_t file) const {
+    std::shared_lock<std::shared_mutex> reader(lock);
+    std::vector<Score> result;
+    auto it = partners.find(file);
+    if (it == partners.end()) {
+        return result;
+    }
+    for (uint64_t other : it->second) {
+        const std::pair<double, double>& stored = scores.at(key(file, other));
+        result.push_back(Score{file, other, stored.first, stored.second});
+    }
+    return result;
+}
+
+
+/**
+ * @brief Number of pairs with a score of the current version.
+ */
+size_t ScoreStore::size() const {
+    std::shared_lock<std::shared_mutex> reader(lock);
+    return scores.size();
+}
+
+
+/**
+ * @brief Records compact() would drop: superseded, torn, or of another scoring version.
+ */
+size_t ScoreStore::deadRecords() const {
+    std::shared_lock<std::shared_mutex> reader(lock);
+    return records - scores.size();
+}
+
+
+/**
+ * @brief Rewrite the store with one record per live pair, to a temporary file renamed into place.
+ *        Records another process appends while the store is rewritten are lost.
+ * @throws std::runtime_error if the compacted store cannot be written.
+ */
+void ScoreStore::compact() {
+    std::unique_lock<std::shared_mutex> writer(lock);
+    std::stringstream suffix;
+    suffix << ".tmp." << getpid();
+    std::filesystem::path temporary = file.string() + suffix.str();
+
+    std::vector<char> data(HEADER);
+    uint32_t header[2] = {MAGIC, VERSION};
+    memcpy(data.data(), header, sizeof(header));
+    for (const auto& score : scores) {
+        Record entry = record(score.first, score.second);
+        data.insert(data.end(), reinterpret_cast<const char*>(&entry), reinterpret_cast<const char*>(&entry + 1));
+    }
+
+    int output = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool written = output >= 0 && write(output, data.data(), data.size()) == (ssize_t) data.size();
+    if (output >= 0) close(output);
+    std::error_code error;
+    if (!written) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("ScoreStore: cannot write " + temporary.string());
+    }
+    std::filesystem::rename(temporary, file);
+
+    close(fd);
+    fd = open(file.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("ScoreStore: cannot open " + file.string());
+    }
+    records = scores.size();
+}
+
+const uint32_t ScoreStore::MAGIC = 0x52435350; // "PSCR"
+const uint32_t ScoreStore::VERSION = 1;
+const size_t ScoreStore::HEADER = 2 * sizeof(uint32_t);
+
+#endif // SCORESTORE_H
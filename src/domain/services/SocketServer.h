@@ -0,0 +1,240 @@
+#ifndef SOCKETSERVER_H
+#define SOCKETSERVER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "BoundedQueue.h"
+
+
+/**
+ * @class SocketServer
+ * @brief Unix domain socket server answering length-prefixed requests.
+ *        Every message, in both directions, is a 4-byte big-endian length followed by the payload.
+ *        A connection may carry any number of requests; a fixed pool of threads serves the
+ *        accepted connections concurrently.
+ *        The program must ignore SIGPIPE (see main), so that a client disconnecting
+ *        mid-response only closes its connection instead of killing the server.
+ */
+class SocketServer {
+    private:
+        const static size_t MAX_MESSAGE;
+        const static size_t BACKLOG;
+
+        std::filesystem::path socketPath;
+        size_t threads;
+        std::function<std::string(const std::string&)> handler;
+        int listener;
+        std::atomic<bool> stopping;
+        std::mutex clientsLock;
+        std::set<int> clients;
+
+        void serve(int);
+
+    public:
+        SocketServer(const std::filesystem::path&, size_t, const std::function<std::string(const std::string&)>&);
+        ~SocketServer();
+        void run();
+        void stop();
+        static bool readMessage(int, std::string&);
+        static bool writeMessage(int, const std::string&);
+};
+
+
+/**
+ * @brief Constructor for the SocketServer class. Binds the socket, replacing a stale socket file,
+ *        and makes it accessible to the server's user only (mode 0600).
+ * @param socketPath Filesystem path of the socket
+ * @param threads Connections served at once
+ * @param handler Turns a request payload into a response payload (called concurrently)
+ * @throws std::runtime_error if the socket cannot be bound.
+ */
+SocketServer::SocketServer(const std::filesystem::path& socketPath, size_t threads, const std::function<std::string(const std::string&)>& handler)
+    : socketPath(socketPath), threads(threads ? threads : 1), handler(handler), listener(-1), stopping(false) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.string().size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("SocketServer: socket path too long: " + socketPath.string());
+    }
+    std::strcpy(address.sun_path, socketPath.c_str());
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        throw std::runtime_error("SocketServer: cannot create socket");
+    }
+    unlink(socketPath.c_str());
+    // Requests name files the server reads, so only its own user may connect: the socket is
+    // restricted before listen() accepts anything
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || chmod(socketPath.c_str(), S_IRUSR | S_IWUSR) != 0 || listen(listener, BACKLOG) != 0) {
+        close(listener);
+        throw std::runtime_error("SocketServer: cannot listen on " + socketPath.string() + ": " + std::strerror(errno));
+    }
+}
+
+
+/**
+ * @brief Destructor for the SocketServer class. Removes the socket file.
+ */
+SocketServer::~SocketServer(){
+    if (listener >= 0) {
+        close(listener);
+    }
+    unlink(socketPath.c_str());
+}
+
+
+/**
+ * @brief Read one length-prefixed message.
+ * @param fd Connected socket
+ * @param message Receives the payload
+ * @return False on end of stream, error, or an oversized message
+ */
+bool SocketServer::readMessage(int fd, std::string& message) {
+    auto readAll = [fd](char* data, size_t size) {
+        while (size > 0) {
+            ssize_t bytes = read(fd, data, size);
+            if (bytes < 0 && errno == EINTR) continue;
+            if (bytes <= 0) return false;
+            data += bytes;
+            size -= bytes;
+        }
+        return true;
+    };
+
+    unsigned char header[4];
+    if (!readAll(reinterpret_cast<char*>(header), 4)) {
+        return false;
+    }
+    size_t size = ((size_t) header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+    if (size > MAX_MESSAGE) {
+        return false;
+    }
+    message.assign(size, '\0');
+    return readAll(&message[0], size);
+}
+
+
+/**
+ * @brief Write one length-prefixed message.
+ * @param fd Connected socket
+ * @param message Payload
+ * @return False if the peer went away
+ */
+bool SocketServer::writeMessage(int fd, const std::string& message) {
+    std::string frame(4, '\0');
+    for (int i = 0; i < 4; i++) {
+        frame[i] = (message.size() >> (24 - 8 * i)) & 0xFF;
+    }
+    frame += message;
+
+    const char* data = frame.data();
+    size_t size = frame.size();
+    while (size > 0) {
+        ssize_t bytes = write(fd, data, size);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) return false;
+        data += bytes;
+        size -= bytes;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Answer every request of a connection, then close it.
+ * @param client Connected socket
+ */
+void SocketServer::serve(int client) {
+    {
+        std::lock_guard<std::mutex> guard(clientsLock);
+        if (stopping) {
+            close(client);
+            return;
+        }
+        clients.insert(client);
+    }
+
+    std::string request;
+    while (!stopping && readMessage(client, request)) {
+        std::string response;
+        try {
+            response = handler(request);
+        } catch (const std::exception& e) {
+            response = std::string("ERROR ") + e.what() + "\n";
+        }
+        if (!writeMessage(client, response)) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(clientsLock);
+    clients.erase(client);
+    close(client);
+}
+
+
+/**
+ * @brief Accept and serve connections until stop() is called.
+ */
+void SocketServer::run() {
+    BoundedQueue<int> connections(threads * 4);
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; t++) {
+        pool.emplace_back([this, &connections]() {
+            int client;
+            while (connections.pop(client)) {
+                serve(client);
+            }
+        });
+    }
+
+    while (!stopping) {
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        if (!connections.push(client)) {
+            close(client);
+        }
+    }
+
+    connections.close();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+
+/**
+ * @brief Make run() return once the connections in progress finish their current request.
+ *        Safe to call from another thread, not from a signal handler.
+ */
+void SocketServer::stop() {
+    std::lock_guard<std::mutex> guard(clientsLock);
+    stopping = true;
+    shutdown(listener, SHUT_RDWR);
+    // Wake connections waiting for their next request
+    for (int client : clients) {
+        shutdown(client, SHUT_RD);
+    }
+}
+
+const size_t SocketServer::MAX_MESSAGE = 1 << 20;
+const size_t SocketServer::BACKLOG = 64;
+
+#endif // SOCKETSERVER_H
@@ -0,0 +1,650 @@
+#ifndef TREESITTERCFGBUILDER_H
+#define TREESITTERCFGBUILDER_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <dlfcn.h>
+#include <tree_sitter/api.h>
+#include "../entities/UGraph.h"
+#include "CFGStreamParser.h"
+#include "GraphArena.h"
+#include "HashService.h"
+#include "Metrics.h"
+
+
+/**
+ * @class TreeSitterCFGBuilder
+ * @brief In-process port of the CFGBuilder in tools/AST.py.
+ *        Parses a source file with the tree-sitter runtime and builds the
+ *        merged CFG (one sub-CFG per method under a ROOT node) directly into a UGraph.
+ */
+class TreeSitterCFGBuilder {
+    private:
+        struct Flow {
+            int entry = -1;
+            std::vector<int> exits;
+        };
+
+        struct MethodGraph {
+            std::string hash;
+            std::vector<std::string> labels;
+            std::vector<std::pair<int, int>> edges;
+        };
+
+        std::string_view code;
+        uint64_t timeout;
+        MethodGraph* current;
+        std::vector<std::pair<int, std::vector<int>>> loopStack;
+
+        static const TSLanguage* loadLanguage(const std::filesystem::path&, const std::string&);
+        static TSParser* parserFor(const TSLanguage*);
+
+        std::string getText(TSNode) const;
+        std::string generateLabel(TSNode) const;
+        int newNode(TSNode);
+        void addEdge(int, int);
+        void connectAll(const std::vector<int>&, int);
+        Flow visit(TSNode);
+        void walkForMethods(TSNode, std::vector<std::pair<std::string, MethodGraph>>&);
+        std::vector<std::pair<std::string, MethodGraph>> parseMethods(const std::filesystem::path&, const std::filesystem::path&, const std::string&);
+        std::vector<std::pair<std::string, MethodGraph>> parseSource(std::string_view, const std::filesystem::path&, const std::string&);
+        static int entryOf(const MethodGraph&);
+        static UGraph<std::string>* merge(const std::vector<std::pair<std::string, MethodGraph>>&, GraphArena*);
+
+    public:
+        TreeSitterCFGBuilder();
+        ~TreeSitterCFGBuilder();
+        void setTimeout(double);
+        UGraph<std::string>* build(const std::filesystem::path&, const std::filesystem::path&, const std::string&, GraphArena* = nullptr);
+        UGraph<std::string>* buildSource(std::string_view, const std::filesystem::path&, const std::string&, GraphArena* = nullptr);
+        std::vector<CFGStreamParser::Method> buildMethods(const std::filesystem::path&, const std::filesystem::path&, const std::string&);
+};
+
+
+/**
+ * @brief Constructor for the TreeSitterCFGBuilder class.
+ */
+TreeSitterCFGBuilder::TreeSitterCFGBuilder() : timeout(0), current(nullptr) {}
+
+
+/**
+ * @brief Destructor for the TreeSitterCFGBuilder class.
+ */
+TreeSitterCFGBuilder::~TreeSitterCFGBuilder(){}
+
+
+/**
+ * @brief Give up parsing a source after a wall-clock budget. In-process builds cannot be
+ *        killed, so this is the only budget they honor.
+ * @param seconds Budget per source, 0 for none
+ */
+void TreeSitterCFGBuilder::setTimeout(double seconds) {
+    timeout = seconds * 1e6;
+}
+
+
+/**
+ * @brief Load a compiled grammar once per process.
+ * @param grammar Path to the shared library built by tools/grammarCompiler.py
+ * @param language Grammar name ('java' resolves the symbol tree_sitter_java)
+ * @throws std::runtime_error if the library or its symbol cannot be loaded.
+ * @return Language handle shared by every builder
+ */
+const TSLanguage* TreeSitterCFGBuilder::loadLanguage(const std::filesystem::path& grammar, const std::string& language) {
+    static std::mutex lock;
+    static std::map<std::string, const TSLanguage*> languages;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::string key = grammar.string() + ":" + language;
+    auto it = languages.find(key);
+    if (it != languages.end()) {
+        return it->second;
+    }
+
+    void* handle = dlopen(grammar.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        throw std::runtime_error("TreeSitterCFGBuilder: cannot load grammar " + grammar.string());
+    }
+
+    std::string symbol = "tree_sitter_" + language;
+    auto factory = reinterpret_cast<const TSLanguage* (*)()>(dlsym(handle, symbol.c_str()));
+    if (!factory) {
+        throw std::runtime_error("TreeSitterCFGBuilder: missing symbol " + symbol);
+    }
+
+    const TSLanguage* result = factory();
+    languages[key] = result;
+    return result;
+}
+
+
+/**
+ * @brief Get the parser of the calling thread, configured for the given language.
+ * @param language Language handle
+ * @return Parser reused across builds on the same thread
+ */
+TSParser* TreeSitterCFGBuilder::parserFor(const TSLanguage* language) {
+    thread_local std::unique_ptr<TSParser, void (*)(TSParser*)> parser(ts_parser_new(), ts_parser_delete);
+    thread_local const TSLanguage* configured = nullptr;
+
+    if (configured != language) {
+        if (!ts_parser_set_language(parser.get(), language)) {
+            throw std::runtime_error("TreeSitterCFGBuilder: incompatible grammar version");
+        }
+        configured = language;
+    }
+    return parser.get();
+}
+
+
+/**
+ * @brief Get the text of a node in the AST.
+ * @param node The node to get the text from
+ * @return Source bytes covered by the node
+ */
+std::string TreeSitterCFGBuilder::getText(TSNode node) const {
+    uint32_t start = ts_node_start_byte(node);
+    uint32_t end = ts_node_end_byte(node);
+    return std::string(code.substr(start, end - start));
+}
+
+
+/**
+ * @brief Generate a label for a node in the AST (concatenated leaf types).
+ * @param node The node to generate a label for
+ * @return The generated label, empty for a missing node
+ */
+std::string TreeSitterCFGBuilder::generateLabel(TSNode node) const {
+    if (ts_node_is_null(node)) {
+        return "";
+    }
+
+    uint32_t count = ts_node_child_count(node);
+    if (count == 0) {
+        return ts_node_type(node);
+    }
+
+    std::string label;
+    for (uint32_t i = 0; i < count; i++) {
+        label += generateLabel(ts_node_child(node, i));
+    }
+    return label;
+}
+
+
+/**
+ * @brief Create a new node in the current method graph with the same label rules as AST.py.
+ * @param node AST node the CFG node represents
+ * @return The index of the new node
+ */
+int TreeSitterCFGBuilder::newNode(TSNode node) {
+    std::string type = ts_node_type(node);
+    std::string label;
+
+    if (type == "expression_statement" || type == "local_variable_declaration") {
+        label = generateLabel(node);
+    } else if (type == "if_statement") {
+        label = "if " + generateLabel(ts_node_child_by_field_name(node, "condition", 9));
+    } else if (type == "for_statement") {
+        label = "for "
+              + generateLabel(ts_node_child_by_field_name(node, "init", 4)) + " "
+              + generateLabel(ts_node_child_by_field_name(node, "condition", 9)) + " "
+              + generateLabel(ts_node_child_by_field_name(node, "update", 6));
+    } else if (type == "while_statement") {
+        label = "while " + generateLabel(ts_node_child_by_field_name(node, "condition", 9));
+    } else if (type == "identifier") {
+        label = "identifier: " + type;
+    } else {
+        label = type;
+        if (ts_node_child_count(node) == 0) {
+            std::string text = getText(node);
+            if (!text.empty()) {
+                label += ": " + text;
+            }
+        }
+    }
+
+    current->labels.push_back(label);
+    return current->labels.size() - 1;
+}
+
+
+/**
+ * @brief Add an edge to the current method graph, ignoring missing endpoints.
+ * @param from Source node
+ * @param to Target node
+ */
+void TreeSitterCFGBuilder::addEdge(int from, int to) {
+    if (from < 0 || to < 0) {
+        return;
+    }
+    current->edges.push_back(std::make_pair(from, to));
+}
+
+
+/**
+ * @brief Connect all nodes `from` -> `to`.
+ * @param from The list of nodes to connect from
+ * @param to The node to connect to
+ */
+void TreeSitterCFGBuilder::connectAll(const std::vector<int>& from, int to) {
+    for (int node : from) {
+        addEdge(node, to);
+    }
+}
+
+
+/**
+ * @brief Visit a node in the AST and build its CFG (CFGBuilder._visit).
+ * @param node The node to visit
+ * @return Entry node (-1 if none) and exit nodes of the sub-CFG
+ */
+TreeSitterCFGBuilder::Flow TreeSitterCFGBuilder::visit(TSNode node) {
+    Flow flow;
+    if (ts_node_is_null(node)) {
+        return flow;
+    }
+
+    std::string type = ts_node_type(node);
+    uint32_t count = ts_node_child_count(node);
+
+    if (type == "block") {
+        for (uint32_t i = 0; i < count; i++) {
+            TSNode child = ts_node_child(node, i);
+            if (!ts_node_is_named(child)) continue;
+
+            Flow subgraph = visit(child);
+            if (subgraph.entry < 0) continue;
+
+            if (flow.entry < 0) {
+                flow.entry = subgraph.entry;
+            }
+            connectAll(flow.exits, subgraph.entry);
+            flow.exits = subgraph.exits;
+        }
+        return flow;
+    }
+
+    if (type == "if_statement") {
+        int condNode = newNode(node);
+        Flow thenBranch = visit(ts_node_child_by_field_name(node, "consequence", 11));
+        TSNode elseNode = ts_node_child_by_field_name(node, "alternative", 11);
+
+        addEdge(condNode, thenBranch.entry);
+        flow.entry = condNode;
+        flow.exits = thenBranch.exits;
+
+        if (!ts_node_is_null(elseNode)) {
+            Flow elseBranch = visit(elseNode);
+            addEdge(condNode, elseBranch.entry);
+            flow.exits.insert(flow.exits.end(), elseBranch.exits.begin(), elseBranch.exits.end());
+        } else {
+            flow.exits.push_back(condNode);
+        }
+        return flow;
+    }
+
+    // As in AST.py, loop frames are pushed after the body has been visited,
+    // so break/continue inside a loop body never see their own loop.
+    if (type == "while_statement" || type == "do_statement") {
+        int condNode = newNode(node);
+        Flow body = visit(ts_node_child_by_field_name(node, "body", 4));
+
+        addEdge(condNode, body.entry);
+        connectAll(body.exits, condNode);
+
+        loopStack.push_back(std::make_pair(condNode, std::vector<int>()));
+        flow.exits = loopStack.back().second;
+        loopStack.pop_back();
+
+        flow.entry = (type == "while_statement")? condNode : body.entry;
+        flow.exits.push_back(condNode);
+        return flow;
+    }
+
+    if (type == "for_statement") {
+        int init = newNode(node);
+        int cond = newNode(node);
+        int update = newNode(node);
+        Flow body = visit(ts_node_child_by_field_name(node, "body", 4));
+
+        addEdge(init, cond);
+        addEdge(cond, body.entry);
+        connectAll(body.exits, update);
+        addEdge(update, cond);
+
+        loopStack.push_back(std::make_pair(cond, std::vector<int>()));
+        flow.exits = loopStack.back().second;
+        loopStack.pop_back();
+
+        flow.entry = init;
+        flow.exits.push_back(cond);
+        return flow;
+    }
+
+    if (type == "switch_expression") {
+        int condNode = newNode(node);
+        TSNode body = ts_node_child_by_field_name(node, "body", 4);
+        flow.entry = condNode;
+        if (ts_node_is_null(body)) {
+            return flow;
+        }
+
+        uint32_t groups = ts_node_child_count(body);
+        for (uint32_t i = 0; i < groups; i++) {
+            TSNode group = ts_node_child(body, i);
+            if (std::string(ts_node_type(group)) != "switch_block_statement_group") continue;
+
+            int labelNode = -1, groupEntry = -1;
+            std::vector<int> groupExit;
+
+            uint32_t members = ts_node_child_count(group);
+            for (uint32_t j = 0; j < members; j++) {
+                TSNode member = ts_node_child(group, j);
+                std::string memberType = ts_node_type(member);
+
+                if (memberType == "switch_label") {
+                    labelNode = newNode(member);
+                    addEdge(condNode, labelNode);
+                } else if (ts_node_is_named(member)) {
+                    Flow subgraph = visit(member);
+                    if (subgraph.entry < 0) continue;
+
+                    if (groupEntry < 0) {
+                        groupEntry = subgraph.entry;
+                        addEdge(labelNode, groupEntry);
+                    } else {
+                        connectAll(groupExit, subgraph.entry);
+                    }
+
+                    groupExit = subgraph.exits;
+                    if (memberType == "break_statement") {
+                        groupExit.push_back(subgraph.entry);
+                    }
+                }
+            }
+            flow.exits.insert(flow.exits.end(), groupExit.begin(), groupExit.end());
+        }
+        return flow;
+    }
+
+    if (type == "try_statement") {
+        int tryStmt = newNode(node);
+        int firstTryNode = current->labels.size();
+        Flow tryBlock = visit(ts_node_child_by_field_name(node, "body", 4));
+        int lastTryNode = current->labels.size();
+        addEdge(tryStmt, tryBlock.entry);
+
+        std::vector<int> catchExits;
+        std::vector<TSNode> finallyClauses;
+        for (uint32_t i = 0; i < count; i++) {
+            TSNode child = ts_node_child(node, i);
+            std::string childType = ts_node_type(child);
+
+            if (childType == "catch_clause") {
+                Flow catchBlock = visit(ts_node_child_by_field_name(child, "body", 4));
+                for (int n = firstTryNode; n < lastTryNode; n++) {
+                    addEdge(n, catchBlock.entry);
+                }
+                catchExits.insert(catchExits.end(), catchBlock.exits.begin(), catchBlock.exits.end());
+            } else if (childType == "finally_clause") {
+                finallyClauses.push_back(child);
+            }
+        }
+
+        flow.entry = tryBlock.entry;
+        flow.exits = tryBlock.exits;
+        flow.exits.insert(flow.exits.end(), catchExits.begin(), catchExits.end());
+
+        if (finallyClauses.size() == 1) {
+            std::vector<TSNode> finallyBlocks;
+            uint32_t members = ts_node_child_count(finallyClauses[0]);
+            for (uint32_t i = 0; i < members; i++) {
+                TSNode child = ts_node_child(finallyClauses[0], i);
+                if (std::string(ts_node_type(child)) == "block") {
+                    finallyBlocks.push_back(child);
+                }
+            }
+
+            if (finallyBlocks.size() == 1) {
+                Flow finalGraph = visit(finallyBlocks[0]);
+                connectAll(flow.exits, finalGraph.entry);
+                flow.exits = finalGraph.exits;
+            }
+        }
+        return flow;
+    }
+
+    if (type == "break_statement") {
+        flow.entry = newNode(node);
+        if (!loopStack.empty()) {
+            loopStack.back().second.push_back(flow.entry);
+        }
+        return flow;
+    }
+
+    if (type == "continue_statement") {
+        flow.entry = newNode(node);
+        if (!loopStack.empty()) {
+            addEdge(flow.entry, loopStack.back().first);
+        }
+        return flow;
+    }
+
+    if (type == "return_statement") {
+        flow.entry = newNode(node);
+        return flow;
+    }
+
+    if (type == "block_comment" || type == "line_comment") {
+        return flow;
+    }
+
+    flow.entry = newNode(node);
+    flow.exits.push_back(flow.entry);
+    return flow;
+}
+
+
+/**
+ * @brief Recursive DFS that builds one CFG per method_declaration (build_CFG in AST.py).
+ *        A repeated method name replaces the earlier CFG but keeps its position.
+ * @param node Current AST node
+ * @param methods Method name and CFG, in discovery order
+ */
+void TreeSitterCFGBuilder::walkForMethods(TSNode node, std::vector<std::pair<std::string, MethodGraph>>& methods) {
+    if (std::string(ts_node_type(node)) == "method_declaration") {
+        std::string name = "unknown_method";
+        uint32_t count = ts_node_child_count(node);
+        for (uint32_t i = 0; i < count; i++) {
+            TSNode child = ts_node_child(node, i);
+            if (std::string(ts_node_type(child)) == "identifier") {
+                name = getText(child);
+                break;
+            }
+        }
+
+        MethodGraph graph;
+        graph.hash = HashService::digest(getText(node));
+        current = &graph;
+        loopStack.clear();
+        visit(ts_node_child_by_field_name(node, "body", 4));
+        current = nullptr;
+
+        auto it = std::find_if(methods.begin(), methods.end(), [&name](const std::pair<std::string, MethodGraph>& m) {
+            return m.first == name;
+        });
+        if (it != methods.end()) {
+            it->second = std::move(graph);
+        } else {
+            methods.push_back(std::make_pair(name, std::move(graph)));
+        }
+    }
+
+    uint32_t count = ts_node_child_count(node);
+    for (uint32_t i = 0; i < count; i++) {
+        walkForMethods(ts_node_child(node, i), methods);
+    }
+}
+
+
+/**
+ * @brief Parse a source file and build the CFG of each of its methods (build_CFG in AST.py).
+ * @param sourceCode File to analyze
+ * @param grammar Path to the compiled grammar
+ * @param language Grammar name
+ * @throws std::runtime_error if the file cannot be read or parsed.
+ * @return Method name and CFG, in source order
+ */
+std::vector<std::pair<std::string, TreeSitterCFGBuilder::MethodGraph>> TreeSitterCFGBuilder::parseMethods(const std::filesystem::path& sourceCode, const std::filesystem::path& grammar, const std::string& language) {
+    std::ifstream input(sourceCode, std::ios::in | std::ios::binary);
+    if (input.fail()) {
+        throw std::runtime_error("TreeSitterCFGBuilder: cannot open " + sourceCode.string());
+    }
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+    return parseSource(buffer.str(), grammar, language);
+}
+
+
+/**
+ * @brief Parse source code held in memory and build the CFG of each of its methods.
+ * @param source Source bytes, e.g. a file of a CorpusArchive
+ * @param grammar Path to the compiled grammar
+ * @param language Grammar name
+ * @throws std::runtime_error if the source cannot be parsed within the timeout.
+ * @return Method name and CFG, in source order
+ */
+std::vector<std::pair<std::string, TreeSitterCFGBuilder::MethodGraph>> TreeSitterCFGBuilder::parseSource(std::string_view source, const std::filesystem::path& grammar, const std::string& language) {
+    TSParser* parser = parserFor(loadLanguage(grammar, language));
+    ts_parser_set_timeout_micros(parser, timeout);
+    std::unique_ptr<TSTree, void (*)(TSTree*)> tree(ts_parser_parse_string(parser, nullptr, source.data(), source.size()), ts_tree_delete);
+    if (!tree) {
+        // A cancelled parse would otherwise resume on the next source
+        ts_parser_reset(parser);
+        if (timeout) {
+            Metrics::add(Metrics::BUDGET_WALL);
+            throw std::runtime_error("TreeSitterCFGBuilder: wall-clock budget exceeded");
+        }
+        throw std::runtime_error("TreeSitterCFGBuilder: cannot parse source");
+    }
+
+    std::vector<std::pair<std::string, MethodGraph>> methods;
+    code = source;
+    walkForMethods(ts_tree_root_node(tree.get()), methods);
+    code = std::string_view();
+    return methods;
+}
+
+
+/**
+ * @brief Entry node of a method CFG: the first node with in-degree 0.
+ * @return Node index, -1 for an empty CFG
+ */
+int TreeSitterCFGBuilder::entryOf(const MethodGraph& cfg) {
+    std::vector<bool> hasPredecessor(cfg.labels.size(), false);
+    for (const auto& edge : cfg.edges) {
+        hasPredecessor[edge.second] = true;
+    }
+    for (size_t i = 0; i < cfg.labels.size(); i++) {
+        if (!hasPredecessor[i]) return i;
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Parse a source file and build its merged CFG (merge_CFGs in AST.py).
+ * @param sourceCode File to analyze
+ * @param grammar Path to the compiled grammar
+ * @param language Grammar name
+ * @param arena Arena that owns the graph, nullptr for a graph owned by the caller
+ * @throws std::runtime_error if the file cannot be read or parsed.
+ * @return UGraph whose vertex 0 is ROOT, linked to each method's entry node
+ */
+UGraph<std::string>* TreeSitterCFGBuilder::build(const std::filesystem::path& sourceCode, const std::filesystem::path& grammar, const std::string& language, GraphArena* arena) {
+    return merge(parseMethods(sourceCode, grammar, language), arena);
+}
+
+
+/**
+ * @brief Build the merged CFG of source code held in memory.
+ * @param source Source bytes, e.g. a file of a CorpusArchive
+ * @param grammar Path to the compiled grammar
+ * @param language Grammar name
+ * @param arena Arena that owns the graph, nullptr for a graph owned by the caller
+ * @throws std::runtime_error if the source cannot be parsed.
+ * @return UGraph whose vertex 0 is ROOT, linked to each method's entry node
+ */
+UGraph<std::string>* TreeSitterCFGBuilder::buildSource(std::string_view source, const std::filesystem::path& grammar, const std::string& language, GraphArena* arena) {
+    return merge(parseSource(source, grammar, language), arena);
+}
+
+
+/**
+ * @brief Merge the CFGs of a file's methods under a ROOT vertex.
+ * @param methods Method name and CFG, in source order
+ * @param arena Arena that owns the graph, nullptr for a graph owned by the caller
+ * @return UGraph whose vertex 0 is ROOT, linked to each method's entry node
+ */
+UGraph<std::string>* TreeSitterCFGBuilder::merge(const std::vector<std::pair<std::string, MethodGraph>>& methods, GraphArena* arena) {
+    UGraph<std::string>* graph = GraphArena::create(arena, true);
+    std::pair<int, std::string> root = std::make_pair(0, std::string("ROOT"));
+    int offset = 1;
+
+    for (const auto& method : methods) {
+        const MethodGraph& cfg = method.second;
+        for (const auto& edge : cfg.edges) {
+            graph->addEdge(std::make_pair(offset + edge.first, cfg.labels[edge.first]),
+                           std::make_pair(offset + edge.second, cfg.labels[edge.second]));
+        }
+
+        int entry = entryOf(cfg);
+        if (entry >= 0) {
+            graph->addEdge(root, std::make_pair(offset + entry, cfg.labels[entry]));
+        }
+
+        offset += cfg.labels.size();
+    }
+
+    return graph;
+}
+
+
+/**
+ * @brief Parse a source file and keep the CFG of each method apart, as CFGStreamParser does
+ *        with the "Methods in CFG" output of tools/AST.py. Methods are hashed by their source.
+ * @param sourceCode File to analyze
+ * @param grammar Path to the compiled grammar
+ * @param language Grammar name
+ * @throws std::runtime_error if the file cannot be read or parsed.
+ * @return Methods of the file, in source order
+ */
+std::vector<CFGStreamParser::Method> TreeSitterCFGBuilder::buildMethods(const std::filesystem::path& sourceCode, const std::filesystem::path& grammar, const std::string& language) {
+    std::vector<CFGStreamParser::Method> result;
+    for (auto& method : parseMethods(sourceCode, grammar, language)) {
+        CFGStreamParser::Method cfg;
+        cfg.hash = method.second.hash;
+        cfg.name = method.first;
+        cfg.entry = entryOf(method.second);
+        cfg.labels = std::move(method.second.labels);
+        cfg.edges = std::move(method.second.edges);
+
+        // The merged UGraph keeps each edge once
+        std::sort(cfg.edges.begin(), cfg.edges.end());
+        cfg.edges.erase(std::unique(cfg.edges.begin(), cfg.edges.end()), cfg.edges.end());
+        result.push_back(std::move(cfg));
+    }
+    return result;
+}
+
+#endif // TREESITTERCFGBUILDER_H
@@ -2,11 +2,34 @@
 
 #include "./application/controllers/CFGBuilderController.h"
 #include "./application/controllers/SimilarityController.h"
+#include "./application/controllers/CorpusController.h"
+#include "./application/controllers/BatchEvaluationController.h"
+#include "./application/controllers/DetectionServerController.h"
+#include "./application/controllers/MethodIndexController.h"
+#include "./application/controllers/ShardController.h"
+#include "./application/controllers/ShardWorkerController.h"
 #include "./domain/entities/UGraph.h"
 #include "./domain/services/StringService.h"
+#include "./domain/services/Metrics.h"
+#include "./domain/services/GraphArena.h"
 
 using namespace std;
 
+const filesystem::path CACHE = filesystem::temp_directory_path() / "plagiarism-detection-cache";
+// Per-file extraction limits: wall-clock seconds, CPU seconds, resident memory
+const ExtractionBudget BUDGET{60.0, 60.0, size_t(2) << 30};
+// Per-tile wall-clock limit of a shard worker, so a stalled worker is killed and its tile retried
+const ExtractionBudget TILE_BUDGET{600.0, 0, 0};
+const filesystem::path SCORES = filesystem::temp_directory_path() / "plagiarism-detection-scores";
+const filesystem::path METRICS = filesystem::temp_directory_path() / "plagiarism-detection-metrics";
+
+void writeMetrics(){
+    ofstream json(METRICS.string() + ".json"), prometheus(METRICS.string() + ".prom");
+    json << Metrics::toJson();
+    prometheus << Metrics::toPrometheus();
+    cout << "Stage timings written to " << METRICS.string() << ".json (.prom)" << endl;
+};
+
 void play(){
     filesystem::path basePath = "../resources/datasets/";
     string first = "T1", second = "T2";
@@ -14,115 +37,322 @@ void play(){
     filesystem::path firstPath = basePath / (first + ".java");
     filesystem::path secondPath = basePath / (second + ".java");
 
+    // Both graphs live until the arena goes out of scope
+    GraphArena arena;
     CFGBuilderController cfgBuilderController;
-    UGraph<string>* firstGraph = cfgBuilderController.getGraph(firstPath);
-    UGraph<string>* secondGraph = cfgBuilderController.getGraph(secondPath);
-
+    UGraph<string>* firstGraph = cfgBuilderController.getGraph(firstPath, &arena);
+    UGraph<string>* secondGraph = cfgBuilderController.getGraph(secondPath, &arena);
+    if (!firstGraph || !secondGraph) {
+        cerr << "Could not build the CFGs of " << firstPath << " and " << secondPath << endl;
+        return;
+    }
 
     SimilarityController similarityController;
-    similarityController.getSimilarity(firstGraph, secondGraph);
-   
 
     cout << "Calculated Similarity: " << similarityController.getSimilarity(firstGraph, secondGraph) << endl;
 };
 
 void test() {
     filesystem::path testBasePath = "../resources/datasets/IR-Plag-Dataset";
-    filesystem::path original, plagiarized, nonPlagiarized;
-
-    UGraph<string>* originalGraph;
-    UGraph<string>* plagiarizedGraph;
-
-    CFGBuilderController cfgBuilderController;
-    SimilarityController similarityController;
-    
+    filesystem::path testArchivePath = "../resources/datasets/IR-Plag-Dataset.pack";
     double isPlagiarized = 0.75;
-    int successPlag = 0, successNonPlag = 0;
-    int totalPlag = 0, totalNonPlag = 0;
-    int error = 0;
-
-    try {
-        for (const auto & testCase : filesystem::directory_iterator(testBasePath)) {
-            error = 0;
-            cout << "CARPETA A ANALIZAR: " << testCase.path() << endl;
 
-            for (const auto & baseFile : filesystem::directory_iterator(testCase.path() / "original")) {
-                cout << "ORIGINAL: " << baseFile.path().string() << endl;
-                original = baseFile.path();  
-            }
-            originalGraph = cfgBuilderController.getGraph(original);
+    BatchEvaluationController evaluationController(max(1u, thread::hardware_concurrency()));
+    evaluationController.useCache(CACHE);
+    evaluationController.useBudget(BUDGET);
 
-            // non-plagiarized
+    // A packed dataset (see pack.cpp) is read instead of the directory when present
+    unique_ptr<CorpusArchive> archive;
+    if (filesystem::exists(testArchivePath)) {
+        try {
+            archive = make_unique<CorpusArchive>(testArchivePath);
+        } catch (const std::exception& e) {
+            cerr << e.what() << endl;
+        }
+    }
 
-            for (const auto & plagFile : filesystem::directory_iterator(testCase.path() / "plagiarized")) {
-                if(is_regular_file(plagFile)) {
-                    cout << "PLAGIO: " << plagFile.path().filename().string() << endl;
-                    plagiarized = plagFile.path();
+    auto onCase = [](const CaseResult& result) {
+        cout << "CARPETA A ANALIZAR: " << result.name << endl;
+        cout << "ORIGINAL: " << result.original.string() << endl;
+        for (const auto& file : result.plagiarized) {
+            cout << "PLAGIO: " << file.first.filename().string() << " similarity: " << file.second << endl;
+        }
+        for (const auto& file : result.nonPlagiarized) {
+            cout << "NO PLAGIO: " << file.first.filename().string() << " similarity: " << file.second << endl;
+        }
+        if (result.totalPlag) {
+            cout << "Plagiarized detection accuracy: " << (double)result.successPlag / result.totalPlag << endl;
+        }
+        if (result.totalNonPlag) {
+            cout << "Non-plagiarized detection accuracy: " << (double)result.successNonPlag / result.totalNonPlag << endl;
+        }
+        if (result.errors) {
+            cerr << "Files that could not be analyzed: " << result.errors << endl;
+        }
+        cout << "\n\n";
+    };
+    EvaluationSummary summary = archive ? evaluationController.evaluate(*archive, isPlagiarized, onCase)
+                                        : evaluationController.evaluate(testBasePath, isPlagiarized, onCase);
 
-                    plagiarizedGraph = cfgBuilderController.getGraph(plagiarized);
+    int total = summary.totalPlag + summary.totalNonPlag;
+    cout << "Cases: " << summary.cases << ", errors: " << summary.errors << endl;
+    if (summary.totalPlag) {
+        cout << "Plagiarized detection accuracy: " << (double)summary.successPlag / summary.totalPlag << endl;
+    }
+    if (summary.totalNonPlag) {
+        cout << "Non-plagiarized detection accuracy: " << (double)summary.successNonPlag / summary.totalNonPlag << endl;
+    }
+    if (total) {
+        cout << "Accuracy: " << (double)(summary.successPlag + summary.successNonPlag) / total << endl;
+    }
+};
 
-                    int similarity = similarityController.getSimilarity(originalGraph, plagiarizedGraph);
-                    successPlag += (similarity >= isPlagiarized)? 1 : 0;
-                    cout << "Plagiarized similarity: " << similarity << endl;
-                    totalPlag++;
-                }   
+bool javaFiles(const filesystem::path& directory, vector<filesystem::path>& files){
+    try {
+        for (const auto & file : filesystem::recursive_directory_iterator(directory)) {
+            if (file.is_regular_file() && file.path().extension() == ".java") {
+                files.push_back(file.path());
             }
-            cout << "Plagiarized detection accuracy: " << (double)successPlag / totalPlag << "\n\n\n";
         }
+    } catch (const std::exception& e) {
+        cerr << "Error while reading " << directory << endl;
+        return false;
+    }
+    return true;
+};
+
+void corpus() {
+    string directory, archiveDirectory;
+    double isPlagiarized = 0.75;
+    size_t bands = 0, rows = 0;
+    vector<filesystem::path> files, archive;
 
-        /*for (const auto & file : filesystem::directory_iterator(originalBasePath)) {
-            cout << "TEST file: " << file.path().filename().string() << endl;
+    cout << "Corpus directory: ";
+    cin >> directory;
+    // LSH trades recall for speed: more bands find more pairs, more rows score fewer
+    cout << "LSH bands (0 to score every pair): ";
+    cin >> bands;
+    if (bands) {
+        cout << "MinHash rows per band: ";
+        cin >> rows;
+    }
+    cout << "Archive of prior years to check against (- for none): ";
+    cin >> archiveDirectory;
 
-            filesystem::path original = originalBasePath / file.path().filename();
-            filesystem::path plagiarized = plagiarizedBasePath / file.path().filename();
-            filesystem::path nonPlagiarized = nonPlagiarizedBasePath / file.path().filename();
+    if (!javaFiles(directory, files)) {
+        return;
+    }
+    bool againstArchive = archiveDirectory != "-";
+    if (againstArchive && !javaFiles(archiveDirectory, archive)) {
+        return;
+    }
 
+    if (!againstArchive && files.size() < 2) {
+        cout << "Corpus needs at least two .java files" << endl;
+        return;
+    }
+
+    CorpusController corpusController(thread::hardware_concurrency());
+    corpusController.useCache(CACHE);
+    corpusController.useBudget(BUDGET);
+    vector<SimilarityPair> pairs;
+    try {
+        if (againstArchive) {
+            pairs = corpusController.getArchivedPairs(files, archive, isPlagiarized, bands ? bands : 16, bands ? rows : 4);
+        } else if (bands) {
+            pairs = corpusController.getSuspiciousPairs(files, isPlagiarized, bands, rows);
+        } else {
             try {
-                UGraph<string>* originalGraph = cfgBuilderController.getGraph(original);
-                UGraph<string>* plagiarizedGraph = cfgBuilderController.getGraph(plagiarized);
-                UGraph<string>* nonPlagiarizedGraph = cfgBuilderController.getGraph(nonPlagiarized);
-
-                int similarity;
-                similarity = similarityController.getSimilarity(originalGraph, plagiarizedGraph);
-                success += (similarity >= isPlagiarized)? 1 : 0;
-                cout << "plagiarized" << similarity << endl;
-
-                similarityController.getSimilarity(originalGraph, nonPlagiarizedGraph);
-                success += (similarity < isPlagiarized)? 1 : 0;
-                
-                cout << similarity << endl;
-                total += 2;
+                corpusController.useScoreStore(SCORES);
             } catch (const std::exception& e) {
-                // Handle standard exceptions
-                cerr << "Error: while transforming " << file << endl;
-                continue;
-            } 
+                cerr << e.what() << ", scoring every pair" << endl;
+            }
+            pairs = corpusController.getSuspiciousPairs(files, isPlagiarized);
+        }
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return;
+    }
+
+    if (againstArchive) {
+        cout << "Archived matches (" << pairs.size() << " of " << files.size() * archive.size() << "):" << endl;
+        for (const SimilarityPair& pair : pairs) {
+            cout << pair.score << " " << files[pair.first].string() << " " << archive[pair.second].string() << endl;
         }
+        return;
+    }
+    cout << "Suspicious pairs (" << pairs.size() << " of " << files.size() * (files.size() - 1) / 2 << "):" << endl;
+    for (const SimilarityPair& pair : pairs) {
+        cout << pair.score << " " << files[pair.first].string() << " " << files[pair.second].string() << endl;
+    }
+};
 
-        cout << "Accuracy: " << (double)success / total << endl;*/
+void methods() {
+    string directory, query;
+    double isPlagiarized = 0.75;
+    vector<filesystem::path> files;
+
+    cout << "Corpus directory: ";
+    cin >> directory;
+    cout << "File to look up: ";
+    cin >> query;
+
+    if (!javaFiles(directory, files)) {
+        return;
+    }
+
+    MethodIndexController methodIndexController(thread::hardware_concurrency());
+    size_t indexed = methodIndexController.index(files);
+    filesystem::path queryPath = query;
+    vector<MethodMatch> matches;
+    try {
+        matches = methodIndexController.getMatches(queryPath, isPlagiarized);
+    } catch (const std::exception& e) {
+        cerr << "Error while analyzing " << query << ": " << e.what() << endl;
+        return;
+    }
+
+    cout << "Matching methods (" << matches.size() << ", " << indexed << " methods indexed in " << files.size() << " files):" << endl;
+    for (const MethodMatch& match : matches) {
+        cout << match.score << " " << match.queryMethod << " " << match.file.string() << " " << match.method << endl;
+    }
+};
+
+int serve(const filesystem::path& socketPath, const filesystem::path& references, size_t threads) {
+    // Signals are taken by a dedicated thread so the server can stop cleanly
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    DetectionServerController server(threads);
+    server.useCache(CACHE);
+    server.useBudget(BUDGET);
+    thread([&server, signals]() {
+        int signal;
+        sigwait(&signals, &signal);
+        server.stop();
+    }).detach();
+
+    try {
+        size_t assignments = server.loadReferences(references);
+        cout << "Loaded " << assignments << " assignments" << endl;
+        cout << "Listening on " << socketPath.string() << endl;
+        server.serve(socketPath, threads);
     } catch (const std::exception& e) {
-        // Handle standard exceptions
-        cerr << "Error while processing test case" << endl;
-    } 
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
 };
 
-int main() {
+int shard(const filesystem::path& directory, size_t workers) {
+    double isPlagiarized = 0.75;
+    vector<filesystem::path> files;
+
+    if (!javaFiles(directory, files)) {
+        return 1;
+    }
+
+    if (files.size() < 2) {
+        cout << "Corpus needs at least two .java files" << endl;
+        return 1;
+    }
+
+    // Workers are this same program, run with --shard-worker
+    vector<SimilarityPair> pairs;
+    ShardReport report;
+    try {
+        ShardController shardController({filesystem::read_symlink("/proc/self/exe").string(), "--shard-worker"}, workers);
+        shardController.useBudget(TILE_BUDGET);
+        pairs = shardController.getSuspiciousPairs(files, isPlagiarized);
+        report = shardController.getReport();
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    cout << "Suspicious pairs (" << pairs.size() << " of " << files.size() * (files.size() - 1) / 2 << "):" << endl;
+    for (const SimilarityPair& pair : pairs) {
+        cout << pair.score << " " << files[pair.first].string() << " " << files[pair.second].string() << endl;
+    }
+    cout << "Tiles: " << report.tiles << ", retries: " << report.retries << ", failed: " << report.failed << endl;
+    cout << "Pairs scored: " << report.pairs << " in " << report.seconds << " s";
+    if (report.seconds > 0) {
+        cout << " (" << report.pairs / report.seconds << " pairs/s)";
+    }
+    cout << endl;
+    writeMetrics();
+    return report.failed ? 1 : 0;
+};
+
+int shardWorker() {
+    ShardWorkerController shardWorkerController(1);
+    shardWorkerController.useCache(CACHE);
+    shardWorkerController.useBudget(BUDGET);
+    try {
+        shardWorkerController.serve();
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+};
+
+int main(int argc, char** argv) {
+    // Dead workers and disconnected clients surface as failed writes instead of killing the program
+    signal(SIGPIPE, SIG_IGN);
+
+    if (argc >= 4 && string(argv[1]) == "--serve") {
+        size_t threads = max(1u, thread::hardware_concurrency());
+        try {
+            if (argc >= 5) threads = stoul(argv[4]);
+        } catch (const std::exception& e) {
+            cerr << "Usage: " << argv[0] << " --serve <socket> <references> [threads]" << endl;
+            return 1;
+        }
+        return serve(argv[2], argv[3], threads);
+    }
+    if (argc >= 3 && string(argv[1]) == "--shard") {
+        size_t workers = max(1u, thread::hardware_concurrency());
+        try {
+            if (argc >= 4) workers = stoul(argv[3]);
+        } catch (const std::exception& e) {
+            cerr << "Usage: " << argv[0] << " --shard <directory> [workers]" << endl;
+            return 1;
+        }
+        return shard(argv[2], workers);
+    }
+    if (argc >= 2 && string(argv[1]) == "--shard-worker") {
+        return shardWorker();
+    }
 
     int option;
     cout << "Welcome to java similarity system" << endl;
 
     do {
-        cout << "Play[1]\nTest[2]\nExit[3]\n\nSelect option: ";
+        cout << "Play[1]\nTest[2]\nExit[3]\nCorpus[4]\nMethods[5]\n\nSelect option: ";
 
         cin >> option;
+        Metrics::reset();
         if (option == 1){
             play();
         } else if (option == 2){
             test();
+            writeMetrics();
         }
         else if (option == 3){
             break;
         }
+        else if (option == 4){
+            corpus();
+            writeMetrics();
+        }
+        else if (option == 5){
+            methods();
+            writeMetrics();
+        }
         
     } while (true);
    
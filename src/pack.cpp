@@ -0,0 +1,51 @@
+#include <bits/stdc++.h>
+
+#include "./application/controllers/CFGBuilderController.h"
+#include "./application/services/CFGBuilderService.h"
+#include "./domain/services/CorpusArchive.h"
+#include "./domain/services/GraphSerializer.h"
+
+using namespace std;
+
+/**
+ * @brief Pack a corpus directory (e.g. IR-Plag-Dataset) into one CorpusArchive.
+ *        With --cfg the CFG of every file is built now and archived with it, so evaluating
+ *        the archive later extracts nothing as long as the grammar and extractor are unchanged.
+ */
+int main(int argc, char** argv) {
+    // Dead extractor workers surface as failed writes instead of killing the program
+    signal(SIGPIPE, SIG_IGN);
+    vector<string> positional;
+    bool cfg = false;
+    size_t threads = max(1u, thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--cfg") cfg = true;
+        else if (arg == "--threads" && i + 1 < argc) threads = stoul(argv[++i]);
+        else positional.push_back(arg);
+    }
+    if (positional.size() != 2) {
+        cerr << "Usage: pack <directory> <archive> [--cfg] [--threads N]" << endl;
+        return 1;
+    }
+
+    try {
+        size_t files;
+        if (cfg) {
+            CFGBuilderController cfgBuilderController(threads);
+            files = CorpusArchive::pack(positional[0], positional[1], CFGBuilderService::cacheSalt(), [&cfgBuilderController](const filesystem::path& file) {
+                filesystem::path source = file;
+                unique_ptr<UGraph<string>> graph(cfgBuilderController.getGraph(source));
+                return graph ? GraphSerializer::serialize(*graph) : string();
+            }, threads);
+        } else {
+            files = CorpusArchive::pack(positional[0], positional[1]);
+        }
+        cout << "Packed " << files << " files into " << positional[1] << endl;
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -19,6 +19,8 @@ Libraries
 `matplotlib`: Library for creating static, animated, and interactive visualizations in Python.
 `sklearn`: Library for machine learning in Python.
 `sys`: Library for system-specific parameters and functions.
+`hashlib`: Library for hashing method bodies.
+`struct`: Library for packing the worker protocol frames and the binary CFG format.
 `warnings`: Library for issuing warning messages.
 
 Usage
@@ -27,12 +29,20 @@ This script is used to parse the AST of a given code snippet using tree-sitter.
 ```
 python AST.py <lang_grammar> <path_grammar> <file>
 ```
+Or, to keep one resident worker that answers framed requests on stdin/stdout (see `serve`):
+```
+python AST.py <lang_grammar> <path_grammar> --worker
+```
+Either form accepts a trailing `--binary` to emit whole-file CFGs in the compact binary
+format of `serialize_CFG` instead of text.
 '''
 
 from tree_sitter import Language, Parser
 import numpy as np
 import matplotlib.pyplot as plt
 import sys
+import struct
+import hashlib
 import networkx as nx
 import warnings
 
@@ -397,7 +407,7 @@ def merge_CFGs(cfg_dict):
     return super_cfg
 
 
-def build_CFG(tree, source_code, cfg_builder_class):
+def build_CFG(tree, source_code, cfg_builder_class, known=frozenset(), method_hashes=None):
     """
     Extracts a CFG for each method in a Java class.
 
@@ -412,9 +422,15 @@ def build_CFG(tree, source_code, cfg_builder_class):
     cfg_builder_class: `CFGBuilder` 
         The CFGBuilder class to build the CFG
 
+    known: `set`
+        Hashes of methods whose CFG the caller already has; they are not built again
+
+    method_hashes: `dict`
+        If given, filled with {method_name: hash of the method's source}
+
     Returns
     ---
-        `dict` Dictionary of {method_name: networkx.DiGraph}
+        `dict` Dictionary of {method_name: networkx.DiGraph}, without the known methods
     """
     root = tree.root_node
     method_cfgs = {}
@@ -430,44 +446,218 @@ def build_CFG(tree, source_code, cfg_builder_class):
     def walk_for_methods(node):
         if node.type == "method_declaration":
             method_name = get_method_name(node)
+            method_hash = hashlib.sha1(source_code[node.start_byte:node.end_byte]).hexdigest()
+            if method_hashes is not None:
+                method_hashes[method_name] = method_hash
 
-            # Build the CFG from the method body
-            node_body = node.child_by_field_name("body")
+            if method_hash in known:
+                method_cfgs.pop(method_name, None)
+            else:
+                # Build the CFG from the method body
+                node_body = node.child_by_field_name("body")
 
-            # Initialize the CFGBuilder for both files
-            builder = cfg_builder_class(source_code)
-            builder.build_from_ast(node_body)
-            method_cfgs[method_name] = builder.graph
+                # Initialize the CFGBuilder for both files
+                builder = cfg_builder_class(source_code)
+                builder.build_from_ast(node_body)
+                method_cfgs[method_name] = builder.graph
         for child in node.children:
             walk_for_methods(child)
 
     walk_for_methods(root)
     return method_cfgs
 
-# Define the constants for the Parser
-lang_grammar, path_grammar, file = sys.argv[1], sys.argv[2], sys.argv[3]
+def parse_CFG(parser, file, known=frozenset(), code=None):
+    """
+    Parse a file and build its merged CFG.
+
+    Parameters
+    ---
+    parser: `Parser`
+        The Tree-sitter parser instance, with its grammar already set
+
+    file: `str`
+        Path to the source file
+
+    known: `set`
+        Hashes of methods the caller already has, left out of the CFG
+
+    code: `bytes`
+        Source of the file, if the caller already has it (`file` is then not read)
+
+    Returns
+    ---
+    CFGraph: `Graph` The merged CFG
+    method_hashes: `dict` Hash of every method, by method name
+    CFSubGraphs: `dict` CFG of every method that was not known, by method name
+    """
+    # Read codes from the provided file path
+    if code is None:
+        with open(file, 'rb') as f:
+            code = f.read()
+
+    # Generate the AST for the provided code snippets
+    tree = parser.parse(code)
+
+    # Generate the CFG's for the provided code snippets
+    method_hashes = {}
+    CFSubGraphs = build_CFG(tree, code, CFGBuilder, known, method_hashes)
+    return merge_CFGs(CFSubGraphs), method_hashes, CFSubGraphs
+
+def extract_CFG(parser, file, known=frozenset(), code=None):
+    """
+    Parse a file and render its merged CFG in the "Nodes in CFG" / "Edges in CFG" text format.
+    A leading "Methods in CFG" section lists "<hash> <method_name>" for every method, with a
+    trailing " cached" for the known methods, whose nodes and edges are left out.
+    Method nodes are named "<method_name>_<n>".
+
+    Parameters
+    ---
+    parser: `Parser`
+        The Tree-sitter parser instance, with its grammar already set
+
+    file: `str`
+        Path to the source file
+
+    known: `set`
+        Hashes of methods the caller already has
+
+    code: `bytes`
+        Source of the file, if the caller already has it
 
-# Initialize the parser
-parser = Parser()
+    Returns
+    ---
+    output: `str` The methods, then the CFG nodes and edges, one per line
+    """
+    CFGraph, method_hashes, CFSubGraphs = parse_CFG(parser, file, known, code)
+
+    # Methods, then nodes and edges of the CFG
+    lines = ["Methods in CFG:"]
+    for method_name, method_hash in method_hashes.items():
+        lines.append(f"{method_hash} {method_name}" + ("" if method_name in CFSubGraphs else " cached"))
+    lines.append("\nNodes in CFG:")
+    for node in CFGraph.nodes(data=True):
+        lines.append(f"{node[0]} {node[1]['label']}")
+    lines.append("\nEdges in CFG:")
+    for edge in CFGraph.edges(data=True):
+        lines.append(f"{edge[0]} {edge[1]}")
+    return "\n".join(lines) + "\n"
+
+def serialize_CFG(parser, file, code=None):
+    """
+    Parse a file and render its merged CFG in the binary format the C++ loader maps straight
+    into a graph (domain/services/GraphSerializer.h), in native byte order with 4-byte fields:
+    "CFGB", version 1, vertex count, label count, edge count, the deduplicated label table
+    (length + UTF-8 bytes), one (id, label index) per vertex and one (from, to) vertex index
+    pair per edge. Vertex ids are the node positions, as the text parser numbers them.
+
+    Parameters
+    ---
+    parser: `Parser`
+        The Tree-sitter parser instance, with its grammar already set
+
+    file: `str`
+        Path to the source file
+
+    code: `bytes`
+        Source of the file, if the caller already has it
+
+    Returns
+    ---
+    output: `bytes` The serialized CFG
+    """
+    CFGraph, _, _ = parse_CFG(parser, file, code=code)
 
-# Set the grammar for the parser
-set_parserGrammar(parser, lang_grammar, path_grammar)
+    index, labels, vertexes = {}, {}, []
+    for node, data in CFGraph.nodes(data=True):
+        index[node] = len(index)
+        vertexes.append((index[node], labels.setdefault(data['label'], len(labels))))
 
-# Read codes from the provided file path
-with open(file, 'rb') as f:
-    code = f.read()
+    table = b"".join(struct.pack("=I", len(label)) + label
+                     for label in (label.encode("utf-8") for label in labels))
+    edges = [index[node] for edge in CFGraph.edges() for node in edge]
 
-# Generate the AST for the provided code snippets
-tree = parser.parse(code)
+    return (b"CFGB" + struct.pack("=4I", 1, len(vertexes), len(labels), CFGraph.number_of_edges())
+            + table
+            + struct.pack(f"={2 * len(vertexes)}I", *(field for vertex in vertexes for field in vertex))
+            + struct.pack(f"={len(edges)}I", *edges))
 
-# Generate the CFG's for the provided code snippets
-CFSubGraphs = build_CFG(tree, code, CFGBuilder)
-CFGraph = merge_CFGs(CFSubGraphs)
+def read_exactly(stream, size):
+    """
+    Read exactly `size` bytes from a binary stream.
+
+    Returns
+    ---
+    data: `bytes` The bytes read, or None if the stream closed first
+    """
+    data = b""
+    while len(data) < size:
+        chunk = stream.read(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+def serve(parser, binary=False):
+    """
+    Worker mode: serve extraction requests from stdin until it is closed.
+
+    Request frame: 4-byte big-endian length + UTF-8 file path, optionally followed by a newline
+    and the space-separated hashes of the methods the caller already has (see extract_CFG).
+    A payload that starts with a NUL byte carries the source itself after it instead of a path
+    (e.g. a file of a packed corpus archive), and asks for its whole-file CFG.
+    Response frame: 1 status byte (0 ok, 1 error) + 4-byte big-endian length + payload.
+    On success the payload is the same text extract_CFG returns, otherwise the error message.
+    In binary mode, requests without known hashes (whole-file CFGs) get the bytes of
+    serialize_CFG instead; method-level requests keep the text, which lists the methods.
 
-# Print nodes and edges of the CFG
-print("Nodes in CFG:")
-for node in CFGraph.nodes(data=True):
-    print(node[0], node[1]['label'])
-print("\nEdges in CFG:")
-for edge in CFGraph.edges(data=True):
-    print(edge[0], edge[1])
\ No newline at end of file
+    Parameters
+    ---
+    parser: `Parser`
+        The Tree-sitter parser instance, with its grammar already set
+
+    binary: `bool`
+        Whether to answer whole-file requests in the binary format
+    """
+    requests, responses = sys.stdin.buffer, sys.stdout.buffer
+
+    while True:
+        header = read_exactly(requests, 4)
+        if header is None:
+            return
+        file = read_exactly(requests, struct.unpack(">I", header)[0])
+        if file is None:
+            return
+
+        try:
+            if file.startswith(b"\0"):
+                path, separator, known, code = None, "", "", file[1:]
+            else:
+                path, separator, known = file.decode("utf-8").partition("\n")
+                code = None
+            if binary and not separator:
+                status, payload = 0, serialize_CFG(parser, path, code)
+            else:
+                status, payload = 0, extract_CFG(parser, path, frozenset(known.split()), code).encode("utf-8")
+        except Exception as e:
+            status, payload = 1, str(e).encode("utf-8")
+
+        responses.write(struct.pack(">BI", status, len(payload)) + payload)
+        responses.flush()
+
+if __name__ == "__main__":
+    # Define the constants for the Parser
+    lang_grammar, path_grammar, file = sys.argv[1], sys.argv[2], sys.argv[3]
+    binary = "--binary" in sys.argv[4:]
+
+    # Initialize the parser
+    parser = Parser()
+
+    # Set the grammar for the parser
+    set_parserGrammar(parser, lang_grammar, path_grammar)
+
+    if file == "--worker":
+        serve(parser, binary)
+    elif binary:
+        sys.stdout.buffer.write(serialize_CFG(parser, file))
+    else:
+        print(extract_CFG(parser, file), end="")
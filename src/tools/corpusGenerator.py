@@ -0,0 +1,173 @@
+'''
+Synthetic Java corpus generator
+--------------------------------------------------------------------------------------------------
+This file generates reproducible Java sources to benchmark the CFG extraction and similarity code
+beyond the sample files in resources/datasets.
+
+Authors
+--------------------------------------------------------------------------------------------------
+  * José Armando Rosas Balderas | A01704132
+  * Ramona Najera Fuentes       | A01423596
+  * Ian Joab Padron Corona      | A01708940
+
+Libraries
+--------------------------------------------------------------------------------------------------
+`argparse`: Library for parsing command-line arguments.
+`random`: Library for generating pseudo-random numbers.
+`os`: Library for interacting with the operating system.
+
+Usage
+--------------------------------------------------------------------------------------------------
+```
+python corpusGenerator.py <output_dir> [--files N] [--methods M] [--statements S] [--depth D]
+                          [--loop-density P] [--try-density P] [--seed SEED]
+```
+'''
+
+import argparse
+import os
+import random
+
+class JavaGenerator:
+    """
+    Class to generate random but syntactically valid Java classes.
+
+    Parameters
+    ---
+    rng: `random.Random` Seeded random generator
+    statements: `int` Statements per block
+    depth: `int` Maximum nesting depth of control structures
+    loop_density: `float` Probability of a loop at each statement
+    try_density: `float` Probability of a try/catch at each statement
+    """
+    def __init__(self, rng, statements, depth, loop_density, try_density):
+        self.rng = rng
+        self.statements = statements
+        self.depth = depth
+        self.loop_density = loop_density
+        self.try_density = try_density
+        self.variables = 0
+
+    def variable(self):
+        """
+        Declare a fresh local variable name.
+
+        Returns
+        ---
+        name: `str` The variable name
+        """
+        self.variables += 1
+        return f"v{self.variables}"
+
+    def expression(self):
+        """
+        Generate a random arithmetic expression.
+
+        Returns
+        ---
+        expr: `str` The expression
+        """
+        op = self.rng.choice(["+", "-", "*", "%"])
+        return f"(x {op} {self.rng.randint(1, 9)})"
+
+    def statement(self, level, indent):
+        """
+        Generate one statement, possibly a nested control structure.
+
+        Parameters
+        ---
+        level: `int` Current nesting level
+        indent: `str` Indentation prefix
+
+        Returns
+        ---
+        lines: `list` Source lines of the statement
+        """
+        roll = self.rng.random()
+        if level < self.depth and roll < self.loop_density:
+            kind = self.rng.choice(["for", "while", "do"])
+            body = self.block(level + 1, indent + "    ")
+            if kind == "for":
+                i = self.variable()
+                return [f"{indent}for (int {i} = 0; {i} < n; {i}++) {{"] + body + [f"{indent}}}"]
+            if kind == "while":
+                return [f"{indent}while (x < n) {{"] + body + [f"{indent}    x++;", f"{indent}}}"]
+            return [f"{indent}do {{"] + body + [f"{indent}    x++;", f"{indent}}} while (x < n);"]
+
+        if level < self.depth and roll < self.loop_density + self.try_density:
+            return ([f"{indent}try {{"] + self.block(level + 1, indent + "    ") +
+                    [f"{indent}}} catch (Exception e) {{"] + self.block(level + 1, indent + "    ") +
+                    [f"{indent}}}"])
+
+        if level < self.depth and roll < self.loop_density + self.try_density + 0.2:
+            return ([f"{indent}if (x > {self.rng.randint(0, 50)}) {{"] + self.block(level + 1, indent + "    ") +
+                    [f"{indent}}} else {{"] + self.block(level + 1, indent + "    ") + [f"{indent}}}"])
+
+        if level < self.depth and roll < self.loop_density + self.try_density + 0.25:
+            cases = []
+            for case in range(self.rng.randint(2, 4)):
+                cases += [f"{indent}    case {case}:"] + self.block(level + 1, indent + "        ") + [f"{indent}        break;"]
+            return [f"{indent}switch (x % 4) {{"] + cases + [f"{indent}}}"]
+
+        if self.rng.random() < 0.5:
+            return [f"{indent}int {self.variable()} = {self.expression()};"]
+        return [f"{indent}x = {self.expression()};"]
+
+    def block(self, level, indent):
+        """
+        Generate the statements of a block.
+
+        Returns
+        ---
+        lines: `list` Source lines of the block
+        """
+        lines = []
+        for _ in range(max(1, self.statements - level)):
+            lines += self.statement(level, indent)
+        return lines
+
+    def java_class(self, name, methods):
+        """
+        Generate a whole class.
+
+        Parameters
+        ---
+        name: `str` Class name
+        methods: `int` Number of methods
+
+        Returns
+        ---
+        source: `str` The Java source
+        """
+        lines = [f"public class {name} {{"]
+        for m in range(methods):
+            self.variables = 0
+            lines += [f"    public int method{m}(int x, int n) {{"]
+            lines += self.block(0, "        ")
+            lines += ["        return x;", "    }", ""]
+        lines += ["}", ""]
+        return "\n".join(lines)
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a synthetic Java corpus.")
+    parser.add_argument("output", help="Directory where the .java files are written")
+    parser.add_argument("--files", type=int, default=100, help="Number of files (corpus size)")
+    parser.add_argument("--methods", type=int, default=5, help="Methods per class")
+    parser.add_argument("--statements", type=int, default=6, help="Statements per top-level block")
+    parser.add_argument("--depth", type=int, default=3, help="Maximum nesting depth")
+    parser.add_argument("--loop-density", type=float, default=0.2, help="Probability of a loop per statement")
+    parser.add_argument("--try-density", type=float, default=0.1, help="Probability of a try/catch per statement")
+    parser.add_argument("--seed", type=int, default=0, help="Random seed (same seed, same corpus)")
+    args = parser.parse_args()
+
+    os.makedirs(args.output, exist_ok=True)
+    rng = random.Random(args.seed)
+    generator = JavaGenerator(rng, args.statements, args.depth, args.loop_density, args.try_density)
+
+    for i in range(args.files):
+        name = f"Synthetic{i:05d}"
+        with open(os.path.join(args.output, name + ".java"), "w") as f:
+            f.write(generator.java_class(name, args.methods))
+
+if __name__ == "__main__":
+    main()
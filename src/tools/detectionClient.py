@@ -0,0 +1,94 @@
+'''
+Detection server client
+--------------------------------------------------------------------------------------------------
+This file sends requests to a running `plagiarism-detector --serve` and prints the responses.
+
+Authors
+--------------------------------------------------------------------------------------------------
+  * José Armando Rosas Balderas | A01704132
+  * Ramona Najera Fuentes       | A01423596
+  * Ian Joab Padron Corona      | A01708940
+
+Libraries
+--------------------------------------------------------------------------------------------------
+`argparse`: Library for parsing command-line arguments.
+`socket`: Library for Unix domain sockets.
+`struct`: Library for packing the message lengths.
+`time`: Library for measuring the round trip.
+
+Usage
+--------------------------------------------------------------------------------------------------
+```
+python detectionClient.py <socket> score <assignment> <file> [<file> ...]
+python detectionClient.py <socket> load <assignment> <directory>
+python detectionClient.py <socket> list
+python detectionClient.py <socket> stats
+```
+'''
+
+import argparse
+import os
+import socket
+import struct
+import time
+
+def read_exactly(connection, size):
+    """
+    Read exactly `size` bytes from the socket.
+
+    Returns
+    ---
+    data: `bytes` The bytes read
+    """
+    data = b""
+    while len(data) < size:
+        chunk = connection.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("server closed the connection")
+        data += chunk
+    return data
+
+def request(connection, line):
+    """
+    Send one request and wait for its response.
+
+    Parameters
+    ---
+    connection: `socket.socket` Connected socket
+    line: `str` Request line
+
+    Returns
+    ---
+    response: `str` Response text
+    """
+    payload = line.encode()
+    connection.sendall(struct.pack(">I", len(payload)) + payload)
+    size = struct.unpack(">I", read_exactly(connection, 4))[0]
+    return read_exactly(connection, size).decode()
+
+def main():
+    parser = argparse.ArgumentParser(description="Query a running detection server.")
+    parser.add_argument("socket", help="Server socket path")
+    parser.add_argument("command", choices=["score", "load", "list", "stats"])
+    parser.add_argument("arguments", nargs="*", help="Assignment, then files (score) or a directory (load)")
+    args = parser.parse_args()
+
+    if args.command == "score" and len(args.arguments) >= 2:
+        lines = [f"SCORE {args.arguments[0]} {os.path.abspath(file)}" for file in args.arguments[1:]]
+    elif args.command == "load" and len(args.arguments) == 2:
+        lines = [f"LOAD {args.arguments[0]} {os.path.abspath(args.arguments[1])}"]
+    elif args.command in ("list", "stats"):
+        lines = [args.command.upper()]
+    else:
+        parser.error("score needs an assignment and files, load an assignment and a directory")
+
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as connection:
+        connection.connect(args.socket)
+        for line in lines:
+            start = time.perf_counter()
+            response = request(connection, line)
+            print(response, end="")
+            print(f"# round trip {(time.perf_counter() - start) * 1000:.3f} ms")
+
+if __name__ == "__main__":
+    main()